@@ -1,8 +1,13 @@
 reset 
 
-g++ -std=c++14 -c -fPIC -g -I../src/ -o icmw.o ../src/icmw.cxx
-g++ -std=c++14 -c -fPIC -g -I../src/ -I/usr/include/libxml2 -o gautier_rss_model.o ../src/gautier_rss_model.cxx
-g++ -std=c++14 -c -fPIC -g -I../src/ -o gautier_rss.o ../src/main.cxx
-
-g++ -g -I../src/ -I/usr/include/libxml2 -lxml2 -lsqlite3 -lfltk -o gautier_rss gautier_rss_model.o gautier_rss.o icmw.o
+g++ -std=c++14 -pthread -c -fPIC -g -I../src/ -o icmw.o ../src/icmw.cxx
+g++ -std=c++14 -pthread -c -fPIC -g -I../src/ -I/usr/include/libxml2 -o gautier_rss_model.o ../src/gautier_rss_model.cxx
+g++ -std=c++14 -pthread -c -fPIC -g -I../src/ -o gautier_rss.o ../src/main.cxx
+g++ -std=c++14 -pthread -c -fPIC -g -I../src/ -o gautier_rss_benchmark.o ../src/gautier_rss_benchmark.cxx
+g++ -std=c++14 -pthread -c -fPIC -g -I../src/ -o gautier_rss_daemon.o ../src/gautier_rss_daemon.cxx
+g++ -std=c++14 -pthread -c -fPIC -g -I../src/ -o gautier_rss_fetch_test.o ../src/gautier_rss_fetch_test.cxx
 
+g++ -g -pthread -I../src/ -I/usr/include/libxml2 -lxml2 -lsqlite3 -lcurl -lz -lbrotlidec -lfltk -o gautier_rss gautier_rss_model.o gautier_rss.o icmw.o
+g++ -g -pthread -I../src/ -o gautier_rss_benchmark gautier_rss_model.o gautier_rss_benchmark.o -lxml2 -lsqlite3 -lcurl -lz -lbrotlidec
+g++ -g -pthread -I../src/ -o gautier_rss_daemon gautier_rss_model.o gautier_rss_daemon.o -lxml2 -lsqlite3 -lcurl -lz -lbrotlidec
+g++ -g -pthread -I../src/ -o gautier_rss_fetch_test gautier_rss_model.o gautier_rss_fetch_test.o -lxml2 -lsqlite3 -lcurl -lz -lbrotlidec
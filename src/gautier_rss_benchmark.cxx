@@ -0,0 +1,378 @@
+#include "gautier_rss_model.hxx"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//Measures the feed model on synthetic feeds written to local disk.
+//Usage: gautier_rss_benchmark [feed count] [items per feed] [description length] [repeat count]
+//The streaming and document tree readers are compared first.
+//	collect_feeds, load_feeds and load_feed then run against a scratch database.
+//Each measurement runs in its own child process so peak memory is reported per measurement.
+//The same arguments always produce the same feeds. Files made by the benchmark are removed at the end.
+
+struct unit_type_benchmark_run
+{
+	long long 
+		item_count{0},
+		elapsed_microseconds{0},
+		peak_memory_kb{0}
+	;
+};
+
+using type_benchmark_pass = std::function<long long()>;
+
+static void 
+make_synthetic_feed(const std::string& file_name, const int feed_n, const int item_count, const int description_length)
+{
+	std::ofstream feed_file(file_name);
+
+	const std::string description(description_length, 'd');
+
+	//Items are an hour apart, counting back from 2 Jan 2017 10:00 GMT.
+	const std::time_t newest_pub_time = 1483351200;
+
+	feed_file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	feed_file << "<rss version=\"2.0\"><channel><title>benchmark " << feed_n << "</title><link>http://localhost/</link>\n";
+
+	for(int item_n = 0; item_n < item_count; item_n++)
+	{
+		const std::time_t pub_time = newest_pub_time - static_cast<std::time_t>(item_n) * 3600;
+
+		std::tm pub_time_parts{};
+
+		gmtime_r(&pub_time, &pub_time_parts);
+
+		char pub_date[64] = {0};
+
+		std::strftime(pub_date, sizeof(pub_date), "%a, %d %b %Y %H:%M:%S GMT", &pub_time_parts);
+
+		feed_file
+		<< "<item>"
+		<< "<title>Item " << item_n << "</title>"
+		<< "<link>http://localhost/feed/" << feed_n << "/item/" << item_n << "</link>"
+		<< "<description><![CDATA[" << description << "]]></description>"
+		<< "<pubDate>" << pub_date << "</pubDate>"
+		<< "</item>\n";
+	}
+
+	feed_file << "</channel></rss>\n";
+
+	return;
+}
+
+//Writes the feeds and a feeds list naming them, in the format of feeds.txt.
+//Returns the combined size of the feed files in bytes.
+static long long 
+make_synthetic_corpus(const std::string& directory_name, const int feed_count, const int item_count, const int description_length, std::vector<std::string>& feed_file_names, const std::string& feeds_list_file_name)
+{
+	long long corpus_size = 0;
+
+	std::ofstream feeds_list_file(feeds_list_file_name);
+
+	for(int feed_n = 0; feed_n < feed_count; feed_n++)
+	{
+		const std::string feed_file_name = directory_name + "/feed_" + std::to_string(feed_n) + ".xml";
+
+		make_synthetic_feed(feed_file_name, feed_n, item_count, description_length);
+
+		feeds_list_file << "Benchmark feed " << feed_n << "\t" << feed_file_name << "\n";
+
+		std::ifstream feed_file(feed_file_name, std::ios::binary | std::ios::ate);
+
+		corpus_size += static_cast<long long>(feed_file.tellg());
+
+		feed_file_names.push_back(feed_file_name);
+	}
+
+	return corpus_size;
+}
+
+//Runs the pass repeat_count times in a child process.
+//The pass returns the number of items it handled.
+//count_pass, when given, runs after each pass outside the measured time and adds the items the pass left behind.
+static unit_type_benchmark_run 
+run_measured(const type_benchmark_pass& run_pass, const int repeat_count, const type_benchmark_pass& count_pass = nullptr)
+{
+	unit_type_benchmark_run benchmark_run;
+
+	int result_pipe[2];
+
+	if(pipe(result_pipe) != 0)
+	{
+		return benchmark_run;
+	}
+
+	const pid_t child_id = fork();
+
+	if(child_id == 0)
+	{
+		close(result_pipe[0]);
+
+		unit_type_benchmark_run child_run;
+
+		std::chrono::steady_clock::duration elapsed_time{0};
+
+		for(int repeat_n = 0; repeat_n < repeat_count; repeat_n++)
+		{
+			const auto start_time = std::chrono::steady_clock::now();
+
+			child_run.item_count += run_pass();
+
+			elapsed_time += std::chrono::steady_clock::now() - start_time;
+
+			if(count_pass)
+			{
+				child_run.item_count += count_pass();
+			}
+		}
+
+		child_run.elapsed_microseconds = 
+		std::chrono::duration_cast<std::chrono::microseconds>(elapsed_time).count();
+
+		gautier::rss_model::close_feeds_storage();
+
+		const auto written = write(result_pipe[1], &child_run, sizeof(child_run));
+
+		close(result_pipe[1]);
+
+		_exit(written == sizeof(child_run) ? 0 : 1);
+	}
+
+	close(result_pipe[1]);
+
+	if(child_id > 0)
+	{
+		const auto read_size = read(result_pipe[0], &benchmark_run, sizeof(benchmark_run));
+
+		if(read_size != sizeof(benchmark_run))
+		{
+			benchmark_run = unit_type_benchmark_run();
+		}
+
+		int child_status = 0;
+		struct rusage child_usage{};
+
+		wait4(child_id, &child_status, 0, &child_usage);
+
+		benchmark_run.peak_memory_kb = child_usage.ru_maxrss;
+	}
+
+	close(result_pipe[0]);
+
+	return benchmark_run;
+}
+
+static long long 
+parse_corpus(const std::vector<std::string>& feed_file_names, const bool use_document_tree)
+{
+	long long item_count = 0;
+
+	for(const auto& feed_file_name : feed_file_names)
+	{
+		std::vector<gautier::rss_model::unit_type_rss_item> feed_items;
+
+		gautier::rss_model::parse_feed(feed_file_name, feed_items, use_document_tree);
+
+		item_count += static_cast<long long>(feed_items.size());
+	}
+
+	return item_count;
+}
+
+static bool 
+compare_parse_output(const std::string& file_name)
+{
+	std::vector<gautier::rss_model::unit_type_rss_item> 
+		stream_items,
+		tree_items
+	;
+
+	gautier::rss_model::parse_feed(file_name, stream_items, false);
+	gautier::rss_model::parse_feed(file_name, tree_items, true);
+
+	bool same = (stream_items.size() == tree_items.size());
+
+	for(decltype(stream_items)::size_type item_n = 0; same && item_n < stream_items.size(); item_n++)
+	{
+		const auto& stream_item = stream_items[item_n];
+		const auto& tree_item = tree_items[item_n];
+
+		same = 
+		stream_item.title == tree_item.title &&
+		stream_item.link == tree_item.link &&
+		stream_item.description == tree_item.description &&
+		stream_item.pubdate == tree_item.pubdate;
+	}
+
+	return same;
+}
+
+static void 
+remove_database_files(const std::string& database_file_name)
+{
+	for(const std::string suffix : {"", "-wal", "-shm", "-journal"})
+	{
+		std::remove((database_file_name + suffix).data());
+	}
+
+	return;
+}
+
+static void 
+output_benchmark_run(const std::string& run_name, const unit_type_benchmark_run& benchmark_run)
+{
+	const double seconds = benchmark_run.elapsed_microseconds / 1000000.0;
+	const double items_per_second = (seconds > 0) ? benchmark_run.item_count / seconds : 0;
+
+	std::cout 
+	<< run_name << "\t"
+	<< benchmark_run.item_count << " items\t"
+	<< seconds << " s\t"
+	<< static_cast<long long>(items_per_second) << " items/s\t"
+	<< benchmark_run.peak_memory_kb << " KB peak\n";
+
+	return;
+}
+
+int main(int argc, char* argv[]) {
+	const int feed_count = (argc > 1) ? std::atoi(argv[1]) : 10;
+	const int item_count = (argc > 2) ? std::atoi(argv[2]) : 2000;
+	const int description_length = (argc > 3) ? std::atoi(argv[3]) : 2000;
+	const int repeat_count = (argc > 4) ? std::atoi(argv[4]) : 3;
+
+	char directory_template[] = "gautier_rss_benchmark_XXXXXX";
+
+	if(!mkdtemp(directory_template))
+	{
+		std::cout << "unable to make a scratch directory.\n";
+
+		return 1;
+	}
+
+	const std::string directory_name = directory_template;
+	const std::string feeds_list_file_name = directory_name + "/feeds.txt";
+	const std::string database_file_name = directory_name + "/benchmark.db";
+
+	std::vector<std::string> feed_file_names;
+
+	const long long corpus_size = 
+	make_synthetic_corpus(directory_name, feed_count, item_count, description_length, feed_file_names, feeds_list_file_name);
+
+	const bool same_output = feed_file_names.empty() || compare_parse_output(feed_file_names.front());
+
+	std::cout 
+	<< "corpus: " << feed_count << " feeds of " << item_count << " items, "
+	<< description_length << " character descriptions, "
+	<< corpus_size / 1024 << " KB, "
+	<< repeat_count << " passes\n";
+
+	output_benchmark_run("stream", run_measured([&feed_file_names]()
+	{
+		return parse_corpus(feed_file_names, false);
+	}, repeat_count));
+
+	output_benchmark_run("tree", run_measured([&feed_file_names]()
+	{
+		return parse_corpus(feed_file_names, true);
+	}, repeat_count));
+
+	gautier::rss_model::unit_type_storage_settings storage_settings;
+
+	storage_settings.database_file_name = database_file_name;
+
+	gautier::rss_model::set_storage_settings(storage_settings);
+
+	//Each pass starts from an empty database so every feed is due and every item is new.
+	output_benchmark_run("collect_feeds", run_measured([&feeds_list_file_name, &database_file_name]()
+	{
+		gautier::rss_model::close_feeds_storage();
+
+		remove_database_files(database_file_name);
+
+		std::map<std::string, gautier::rss_model::unit_type_rss_source> feed_sources;
+
+		gautier::rss_model::load_feeds_source_list(feeds_list_file_name, feed_sources);
+
+		gautier::rss_model::collect_feeds(feed_sources);
+
+		return 0LL;
+	}, repeat_count, []()
+	{
+		//Counted outside the measured time, so the rate is that of collecting alone.
+		//Visited one item at a time, so the peak memory is not raised by holding every item.
+		long long saved_item_count = 0;
+
+		gautier::rss_model::visit_feeds([&saved_item_count](const std::string&, const gautier::rss_model::unit_type_rss_item&)
+		{
+			saved_item_count++;
+		});
+
+		return saved_item_count;
+	}));
+
+	//Reads the database left by the last collect_feeds pass.
+	output_benchmark_run("load_feeds", run_measured([]()
+	{
+		std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> rss_feed_items;
+
+		gautier::rss_model::load_feeds(rss_feed_items);
+
+		long long loaded_item_count = 0;
+
+		for(const auto& rss_feed_item : rss_feed_items)
+		{
+			loaded_item_count += static_cast<long long>(rss_feed_item.second.size());
+		}
+
+		return loaded_item_count;
+	}, repeat_count));
+
+	output_benchmark_run("load_feed", run_measured([feed_count]()
+	{
+		long long loaded_item_count = 0;
+
+		for(int feed_n = 0; feed_n < feed_count; feed_n++)
+		{
+			const std::string feed_name = "Benchmark feed " + std::to_string(feed_n);
+
+			std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> rss_feed_items;
+
+			gautier::rss_model::load_feed(feed_name, rss_feed_items);
+
+			loaded_item_count += static_cast<long long>(rss_feed_items[feed_name].size());
+		}
+
+		return loaded_item_count;
+	}, repeat_count));
+
+	std::cout 
+	<< "readers produce " << (same_output ? "the same" : "DIFFERENT") << " items\n";
+
+	remove_database_files(database_file_name);
+
+	for(const auto& feed_file_name : feed_file_names)
+	{
+		std::remove(feed_file_name.data());
+	}
+
+	std::remove(feeds_list_file_name.data());
+
+	rmdir(directory_name.data());
+
+	return same_output ? 0 : 1;
+}
+
+/*Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0 . Software distributed under the License is distributed on an "AS IS" BASIS, NO WARRANTIES OR CONDITIONS OF ANY KIND, explicit or implicit. See the License for details on permissions and limitations.*/
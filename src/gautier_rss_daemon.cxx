@@ -0,0 +1,280 @@
+#include "gautier_rss_model.hxx"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+
+#include <unistd.h>
+
+//Collects feeds on a schedule without a display, for running as a service.
+//Usage: gautier_rss_daemon [feeds list file] [interval seconds] [database file] [retention days]
+//Defaults are feeds.txt, 300 seconds, the database used by the application and 31 days.
+//An interval of 0 collects once and exits.
+//Items saved longer ago than the retention are purged hourly, on a timer of their own.
+//	A purge does not start a collection, so intervals longer than an hour are kept.
+//	A retention of 0 keeps items, unless their feed sets its own in the feeds list.
+//Each feed is only downloaded once it is due, so the interval is how often due feeds are looked for.
+//	The wait is cut short when a feed becomes due sooner.
+//SIGINT and SIGTERM stop the program once a collection under way is saved. A second signal stops it at once.
+//SIGHUP reads the feeds list again and starts a collection.
+
+//Exit status.
+static const int 
+	_exit_stopped = 0,
+	_exit_usage = 1,
+	_exit_feeds_list_unreadable = 2,
+	_exit_no_feed_sources = 3
+;
+
+//Shortest wait between collections when a feed is due sooner than the interval.
+static const long long 
+	_min_wait_seconds = 60,
+	_purge_interval_seconds = 60 * 60
+;
+
+static const int 
+	//Rows removed per transaction while purging.
+	_purge_batch_size = 500
+;
+
+static volatile std::sig_atomic_t 
+	_stop_requested = 0,
+	_reload_requested = 0
+;
+
+static void 
+handle_stop_signal(int)
+{
+	_stop_requested = 1;
+
+	return;
+}
+
+static void 
+handle_reload_signal(int)
+{
+	_reload_requested = 1;
+
+	return;
+}
+
+static void 
+set_signal_handlers()
+{
+	struct sigaction stop_action{};
+
+	stop_action.sa_handler = handle_stop_signal;
+	//The handler is reset after the first signal so another one ends the program.
+	stop_action.sa_flags = SA_RESETHAND;
+	sigemptyset(&stop_action.sa_mask);
+
+	sigaction(SIGINT, &stop_action, nullptr);
+	sigaction(SIGTERM, &stop_action, nullptr);
+
+	struct sigaction reload_action{};
+
+	reload_action.sa_handler = handle_reload_signal;
+	sigemptyset(&reload_action.sa_mask);
+
+	sigaction(SIGHUP, &reload_action, nullptr);
+
+	//A closed connection is reported by the network library rather than ending the program.
+	std::signal(SIGPIPE, SIG_IGN);
+
+	return;
+}
+
+//Reads a whole number argument that may not be negative.
+static bool 
+read_count_argument(const char* argument, long long& value)
+{
+	char* argument_end = nullptr;
+
+	value = std::strtoll(argument, &argument_end, 10);
+
+	return argument_end != argument && *argument_end == '\0' && value >= 0;
+}
+
+static void 
+output_log_line(const std::string& message)
+{
+	const std::time_t now = std::time(nullptr);
+
+	std::tm now_parts{};
+
+	localtime_r(&now, &now_parts);
+
+	char now_text[32] = {0};
+
+	std::strftime(now_text, sizeof(now_text), "%Y-%m-%d %H:%M:%S", &now_parts);
+
+	std::cout << now_text << "\t" << message << std::endl;
+
+	return;
+}
+
+//Seconds until the next collection.
+//The interval unless a feed is due sooner, but never less than _min_wait_seconds or more than the interval.
+static long long 
+get_wait_seconds(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, const long long interval_seconds)
+{
+	const long long now = static_cast<long long>(std::time(nullptr));
+
+	long long wait_seconds = interval_seconds;
+
+	for(const auto& feed_source : feed_sources)
+	{
+		const long long next_due = feed_source.second.next_due;
+
+		if(next_due > 0)
+		{
+			wait_seconds = std::min(wait_seconds, next_due - now);
+		}
+	}
+
+	return std::max(wait_seconds, std::min(_min_wait_seconds, interval_seconds));
+}
+
+//Waits until the next collection or purge is due.
+//Returns early when a signal asks to stop or reload.
+//Sleeps one second at a time since a signal may be delivered to a thread other than this one.
+static void 
+wait_for_next_pass(const long long wait_seconds)
+{
+	for(long long waited = 0; waited < wait_seconds && !_stop_requested && !_reload_requested; waited++)
+	{
+		sleep(1);
+	}
+
+	return;
+}
+
+int main(int argc, char* argv[]) {
+	const std::string feeds_list_file_name = (argc > 1) ? argv[1] : "feeds.txt";
+
+	long long 
+		interval_seconds = 300,
+		retention_days = 31
+	;
+
+	if((argc > 2 && !read_count_argument(argv[2], interval_seconds)) 
+	|| (argc > 4 && (!read_count_argument(argv[4], retention_days) || retention_days > std::numeric_limits<int>::max())))
+	{
+		std::cerr << "usage: gautier_rss_daemon [feeds list file] [interval seconds] [database file] [retention days]\n";
+
+		return _exit_usage;
+	}
+
+	if(!std::ifstream(feeds_list_file_name))
+	{
+		std::cerr << "unable to read the feeds list " << feeds_list_file_name << "\n";
+
+		return _exit_feeds_list_unreadable;
+	}
+
+	set_signal_handlers();
+
+	//Readers of the database, such as the application, are not held up while feeds are saved.
+	gautier::rss_model::unit_type_storage_settings storage_settings;
+
+	storage_settings.write_ahead_log = true;
+	storage_settings.synchronous = "NORMAL";
+
+	if(argc > 3)
+	{
+		storage_settings.database_file_name = argv[3];
+	}
+
+	gautier::rss_model::set_storage_settings(storage_settings);
+
+	std::map<std::string, gautier::rss_model::unit_type_rss_source> feed_sources;
+
+	gautier::rss_model::load_feeds_source_list(feeds_list_file_name, feed_sources);
+
+	int exit_status = _exit_stopped;
+
+	//Seconds since the epoch when each is next run. Both run on the first pass.
+	long long 
+		next_collection_time = 0,
+		next_purge_time = 0
+	;
+
+	while(!_stop_requested)
+	{
+		if(_reload_requested || std::time(nullptr) >= next_collection_time)
+		{
+			if(_reload_requested)
+			{
+				_reload_requested = 0;
+
+				feed_sources.clear();
+
+				gautier::rss_model::load_feeds_source_list(feeds_list_file_name, feed_sources);
+
+				output_log_line("feeds list read again");
+			}
+			else
+			{
+				gautier::rss_model::load_feeds_source_list(feed_sources);
+			}
+
+			if(feed_sources.empty())
+			{
+				output_log_line("no feed sources in " + feeds_list_file_name + " or the database could not be opened");
+
+				exit_status = _exit_no_feed_sources;
+
+				break;
+			}
+
+			const auto due_count = std::count_if(feed_sources.begin(), feed_sources.end(), [](const std::pair<const std::string, gautier::rss_model::unit_type_rss_source>& feed_source)
+			{
+				return feed_source.second.type_code == 3;
+			});
+
+			gautier::rss_model::collect_feeds(feed_sources);
+
+			output_log_line("collected " + std::to_string(due_count) + " of " + std::to_string(feed_sources.size()) + " feeds");
+
+			//Picks up the next due times set by the collection.
+			gautier::rss_model::load_feeds_source_list(feed_sources);
+
+			next_collection_time = static_cast<long long>(std::time(nullptr)) + get_wait_seconds(feed_sources, interval_seconds);
+		}
+
+		//Runs on its own timer. A purge that comes due does not start a collection.
+		if(std::time(nullptr) >= next_purge_time)
+		{
+			const long long purged_count = 
+			gautier::rss_model::purge_feeds(static_cast<int>(retention_days), _purge_batch_size);
+
+			next_purge_time = static_cast<long long>(std::time(nullptr)) + _purge_interval_seconds;
+
+			output_log_line("purged " + std::to_string(purged_count) + " feed items");
+		}
+
+		if(interval_seconds == 0)
+		{
+			break;
+		}
+
+		wait_for_next_pass(std::min(next_collection_time, next_purge_time) - static_cast<long long>(std::time(nullptr)));
+	}
+
+	gautier::rss_model::close_feeds_storage();
+
+	if(_stop_requested)
+	{
+		output_log_line("stopped");
+	}
+
+	return exit_status;
+}
+
+/*Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0 . Software distributed under the License is distributed on an "AS IS" BASIS, NO WARRANTIES OR CONDITIONS OF ANY KIND, explicit or implicit. See the License for details on permissions and limitations.*/
@@ -0,0 +1,606 @@
+#include "gautier_rss_model.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+//Checks conditional downloads of a feed against an HTTP server on the loopback interface.
+//Usage: gautier_rss_fetch_test
+//The first download gets a 200 response. Its ETag and Last-Modified have to be saved with the feed source.
+//The second download sends them back and gets a 304 response. The feed must then be neither parsed nor saved.
+//Two more feeds check the decoding of the body. One is gzip coded in two members and sent a byte at a time.
+//	Its items have to be saved. Another is gzip coded and followed by zero padding, which has to be ignored.
+//	The last has a Content-Encoding that cannot be decoded and must not be saved.
+//Exits with 0 when every check passes. Files made by the test are removed at the end.
+
+static const std::string 
+	_feed_name = "Loopback feed",
+	_gzip_feed_name = "Loopback gzip feed",
+	_padded_gzip_feed_name = "Loopback padded gzip feed",
+	_unsupported_feed_name = "Loopback compress feed",
+	_feed_etag = "\"loopback-1\"",
+	_feed_last_modified = "Tue, 10 Jun 2003 04:00:00 GMT",
+	_feed_document = 
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<rss version=\"2.0\"><channel><title>loopback</title><link>http://127.0.0.1/</link>\n"
+	"<item><title>Item 1</title><link>http://127.0.0.1/item/1</link><description>first</description><pubDate>Tue, 10 Jun 2003 04:00:00 GMT</pubDate></item>\n"
+	"<item><title>Item 2</title><link>http://127.0.0.1/item/2</link><description>second</description><pubDate>Tue, 10 Jun 2003 03:00:00 GMT</pubDate></item>\n"
+	"</channel></rss>\n"
+;
+
+//Requests seen by the server, in the order received.
+struct unit_type_loopback_request
+{
+	std::string 
+		path{""},
+		if_none_match{""},
+		if_modified_since{""}
+	;
+
+	int 
+		response_code{0}
+	;
+};
+
+struct unit_type_loopback_server
+{
+	int 
+		listen_socket{-1},
+		port{0}
+	;
+
+	std::atomic<bool> 
+		stopping{false}
+	;
+
+	//Written by the server thread. Read through get_loopback_requests.
+	std::vector<unit_type_loopback_request> 
+		requests
+	;
+
+	std::mutex 
+		requests_lock
+	;
+
+	std::thread 
+		server_thread
+	;
+};
+
+static int _failure_count = 0;
+
+static void 
+check(const bool passed, const std::string& description)
+{
+	std::cout << (passed ? "ok\t" : "FAILED\t") << description << "\n";
+
+	if(!passed)
+	{
+		_failure_count++;
+	}
+
+	return;
+}
+
+//Value of a request header, matched without regard to case. Empty when the header is absent.
+static std::string 
+get_header_value(const std::string& request_text, const std::string& header_name)
+{
+	std::string 
+	lower_request = request_text;
+
+	for(auto& request_char : lower_request)
+	{
+		request_char = static_cast<char>(std::tolower(static_cast<unsigned char>(request_char)));
+	}
+
+	std::string 
+	lower_name = "\r\n" + header_name + ":";
+
+	for(auto& name_char : lower_name)
+	{
+		name_char = static_cast<char>(std::tolower(static_cast<unsigned char>(name_char)));
+	}
+
+	const auto name_pos = lower_request.find(lower_name);
+
+	if(name_pos == std::string::npos)
+	{
+		return "";
+	}
+
+	auto value_begin = name_pos + lower_name.size();
+	const auto value_end = request_text.find("\r\n", value_begin);
+
+	while(value_begin < value_end && request_text[value_begin] == ' ')
+	{
+		value_begin++;
+	}
+
+	return request_text.substr(value_begin, value_end - value_begin);
+}
+
+//The feed document with links of its own, under link_path, since a link is saved once across all feeds.
+static std::string 
+get_coded_feed_document(const std::string& link_path)
+{
+	std::string 
+	coded_document = _feed_document;
+
+	for(auto link_pos = coded_document.find("/item/"); link_pos != std::string::npos; link_pos = coded_document.find("/item/", link_pos))
+	{
+		coded_document.replace(link_pos, 6, link_path);
+	}
+
+	return coded_document;
+}
+
+//gzip coded text, in the format of a single member.
+static std::string 
+get_gzip_member(const std::string& text)
+{
+	std::string 
+	member(compressBound(static_cast<uLong>(text.size())) + 32, '\0');
+
+	z_stream encoder{};
+
+	if(deflateInit2(&encoder, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return "";
+	}
+
+	encoder.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+	encoder.avail_in = static_cast<uInt>(text.size());
+	encoder.next_out = reinterpret_cast<Bytef*>(&member[0]);
+	encoder.avail_out = static_cast<uInt>(member.size());
+
+	const int encode_result = deflate(&encoder, Z_FINISH);
+
+	member.resize(encoder.total_out);
+
+	deflateEnd(&encoder);
+
+	return (encode_result == Z_STREAM_END) ? member : "";
+}
+
+static void 
+write_response(const int connection, const std::string& response_text, const std::string::size_type write_limit)
+{
+	std::string::size_type written_size = 0;
+
+	while(written_size < response_text.size())
+	{
+		//A client that ends the transfer early must not end the test with SIGPIPE.
+		const auto write_size = send(connection, response_text.data() + written_size, std::min(write_limit, response_text.size() - written_size), MSG_NOSIGNAL);
+
+		if(write_size <= 0)
+		{
+			break;
+		}
+
+		written_size += static_cast<std::string::size_type>(write_size);
+
+		//Gives the client a chance to receive each write on its own.
+		if(write_limit == 1)
+		{
+			usleep(500);
+		}
+	}
+
+	return;
+}
+
+//Answers one request per connection. A request carrying the current ETag gets a 304 response.
+static void 
+serve_loopback_requests(unit_type_loopback_server& server)
+{
+	while(!server.stopping)
+	{
+		const int connection = accept(server.listen_socket, nullptr, nullptr);
+
+		if(connection < 0)
+		{
+			continue;
+		}
+
+		std::string request_text;
+
+		char buffer[4096];
+
+		while(request_text.find("\r\n\r\n") == std::string::npos)
+		{
+			const auto read_size = read(connection, buffer, sizeof(buffer));
+
+			if(read_size <= 0)
+			{
+				break;
+			}
+
+			request_text.append(buffer, static_cast<std::string::size_type>(read_size));
+		}
+
+		if(!request_text.empty())
+		{
+			unit_type_loopback_request request;
+
+			const auto path_begin = request_text.find(' ') + 1;
+
+			request.path = request_text.substr(path_begin, request_text.find(' ', path_begin) - path_begin);
+			request.if_none_match = get_header_value(request_text, "If-None-Match");
+			request.if_modified_since = get_header_value(request_text, "If-Modified-Since");
+
+			std::string response_text;
+
+			std::string::size_type write_limit = std::string::npos;
+
+			if(request.path == "/gzip.xml")
+			{
+				request.response_code = 200;
+
+				const std::string coded_document = get_coded_feed_document("/coded/");
+
+				const auto split_pos = coded_document.size() / 2;
+
+				const std::string body = 
+				get_gzip_member(coded_document.substr(0, split_pos)) + get_gzip_member(coded_document.substr(split_pos));
+
+				response_text = 
+				"HTTP/1.1 200 OK\r\n"
+				"Content-Type: application/rss+xml\r\n"
+				"Content-Encoding: gzip\r\n"
+				"Content-Length: " + std::to_string(body.size()) + "\r\n"
+				"Connection: close\r\n\r\n"
+				+ body;
+
+				write_limit = 1;
+			}
+			else if(request.path == "/padded_gzip.xml")
+			{
+				request.response_code = 200;
+
+				const std::string body = 
+				get_gzip_member(get_coded_feed_document("/padded/")) + std::string(16, '\0');
+
+				response_text = 
+				"HTTP/1.1 200 OK\r\n"
+				"Content-Type: application/rss+xml\r\n"
+				"Content-Encoding: gzip\r\n"
+				"Content-Length: " + std::to_string(body.size()) + "\r\n"
+				"Connection: close\r\n\r\n"
+				+ body;
+			}
+			else if(request.path == "/compress.xml")
+			{
+				request.response_code = 200;
+
+				response_text = 
+				"HTTP/1.1 200 OK\r\n"
+				"Content-Type: application/rss+xml\r\n"
+				"Content-Encoding: compress\r\n"
+				"Content-Length: " + std::to_string(get_coded_feed_document("/compress/").size()) + "\r\n"
+				"Connection: close\r\n\r\n"
+				+ get_coded_feed_document("/compress/");
+			}
+			else if(request.if_none_match == _feed_etag)
+			{
+				request.response_code = 304;
+
+				response_text = 
+				"HTTP/1.1 304 Not Modified\r\n"
+				"ETag: " + _feed_etag + "\r\n"
+				"Connection: close\r\n\r\n";
+			}
+			else
+			{
+				request.response_code = 200;
+
+				response_text = 
+				"HTTP/1.1 200 OK\r\n"
+				"Content-Type: application/rss+xml\r\n"
+				"Content-Length: " + std::to_string(_feed_document.size()) + "\r\n"
+				"ETag: " + _feed_etag + "\r\n"
+				"Last-Modified: " + _feed_last_modified + "\r\n"
+				"Connection: close\r\n\r\n"
+				+ _feed_document;
+			}
+
+			{
+				std::lock_guard<std::mutex> requests_guard(server.requests_lock);
+
+				server.requests.push_back(request);
+			}
+
+			if(write_limit == 1)
+			{
+				const int no_delay = 1;
+
+				setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+			}
+
+			write_response(connection, response_text, write_limit);
+		}
+
+		close(connection);
+	}
+
+	return;
+}
+
+//Listens on a port chosen by the system.
+static bool 
+start_loopback_server(unit_type_loopback_server& server)
+{
+	server.listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+
+	if(server.listen_socket < 0)
+	{
+		return false;
+	}
+
+	struct sockaddr_in address{};
+
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;
+
+	socklen_t address_size = sizeof(address);
+
+	if(bind(server.listen_socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0
+	|| listen(server.listen_socket, 8) != 0
+	|| getsockname(server.listen_socket, reinterpret_cast<struct sockaddr*>(&address), &address_size) != 0)
+	{
+		close(server.listen_socket);
+
+		return false;
+	}
+
+	server.port = ntohs(address.sin_port);
+	server.server_thread = std::thread(serve_loopback_requests, std::ref(server));
+
+	return true;
+}
+
+static void 
+stop_loopback_server(unit_type_loopback_server& server)
+{
+	server.stopping = true;
+
+	//Wakes the server from accept.
+	shutdown(server.listen_socket, SHUT_RDWR);
+
+	if(server.server_thread.joinable())
+	{
+		server.server_thread.join();
+	}
+
+	close(server.listen_socket);
+
+	return;
+}
+
+static std::vector<unit_type_loopback_request> 
+get_loopback_requests(unit_type_loopback_server& server)
+{
+	std::lock_guard<std::mutex> requests_guard(server.requests_lock);
+
+	return server.requests;
+}
+
+static long long 
+get_feed_stage_count(const gautier::rss_model::unit_type_rss_metrics& metrics, const std::string& stage_name)
+{
+	const auto feed_metrics = metrics.feeds.find(_feed_name);
+
+	if(feed_metrics == metrics.feeds.end())
+	{
+		return 0;
+	}
+
+	const auto stage_metrics = feed_metrics->second.stages.find(stage_name);
+
+	return (stage_metrics == feed_metrics->second.stages.end()) ? 0 : stage_metrics->second.count;
+}
+
+static long long 
+get_stage_count(const gautier::rss_model::unit_type_rss_metrics& metrics, const std::string& stage_name)
+{
+	const auto stage_metrics = metrics.stages.find(stage_name);
+
+	return (stage_metrics == metrics.stages.end()) ? 0 : stage_metrics->second.count;
+}
+
+int main() {
+	char directory_template[] = "gautier_rss_fetch_test_XXXXXX";
+
+	if(!mkdtemp(directory_template))
+	{
+		std::cout << "unable to make a scratch directory.\n";
+
+		return 1;
+	}
+
+	const std::string directory_name = directory_template;
+	const std::string feeds_list_file_name = directory_name + "/feeds.txt";
+	const std::string coded_feeds_list_file_name = directory_name + "/coded_feeds.txt";
+	const std::string database_file_name = directory_name + "/fetch_test.db";
+
+	unit_type_loopback_server server;
+
+	if(!start_loopback_server(server))
+	{
+		std::cout << "unable to listen on the loopback interface.\n";
+
+		rmdir(directory_name.data());
+
+		return 1;
+	}
+
+	std::ofstream(feeds_list_file_name)
+	<< _feed_name << "\thttp://127.0.0.1:" << server.port << "/feed.xml\n";
+
+	gautier::rss_model::unit_type_storage_settings storage_settings;
+
+	storage_settings.database_file_name = database_file_name;
+
+	gautier::rss_model::set_storage_settings(storage_settings);
+	gautier::rss_model::set_metrics_enabled(true);
+
+	std::map<std::string, gautier::rss_model::unit_type_rss_source> feed_sources;
+
+	gautier::rss_model::load_feeds_source_list(feeds_list_file_name, feed_sources);
+
+	//200: the feed is parsed, saved, and its cache validators kept.
+	gautier::rss_model::collect_feeds(feed_sources);
+
+	{
+		std::map<std::string, gautier::rss_model::unit_type_feed_transfer> feed_transfers;
+
+		gautier::rss_model::load_feed_transfers(feed_transfers);
+
+		const auto requests = get_loopback_requests(server);
+
+		check(requests.size() == 1 && requests.back().if_none_match.empty(), "first request is not conditional");
+		check(feed_transfers[_feed_name].response_code == 200, "first download gets 200");
+
+		std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> rss_feed_items;
+
+		gautier::rss_model::load_feed(_feed_name, rss_feed_items);
+
+		check(rss_feed_items[_feed_name].size() == 2, "items of the 200 response are saved");
+
+		gautier::rss_model::load_feeds_source_list(feed_sources);
+
+		check(feed_sources[_feed_name].etag == _feed_etag, "ETag is saved");
+		check(feed_sources[_feed_name].last_modified == _feed_last_modified, "Last-Modified is saved");
+	}
+
+	gautier::rss_model::unit_type_rss_metrics first_metrics;
+
+	gautier::rss_model::load_metrics(first_metrics);
+
+	check(get_feed_stage_count(first_metrics, "parse") == 1, "200 response is parsed");
+	check(get_stage_count(first_metrics, "merge") == 1, "200 response is saved");
+
+	//304: the saved validators are sent back. Nothing is parsed or saved.
+	//The feed was just downloaded, so it is marked due by hand.
+	feed_sources[_feed_name].type_code = 3;
+
+	gautier::rss_model::collect_feeds(feed_sources);
+
+	{
+		std::map<std::string, gautier::rss_model::unit_type_feed_transfer> feed_transfers;
+
+		gautier::rss_model::load_feed_transfers(feed_transfers);
+
+		const auto requests = get_loopback_requests(server);
+
+		check(requests.size() == 2, "second download is requested");
+
+		if(requests.size() == 2)
+		{
+			check(requests.back().response_code == 304, "server answers the second request with 304");
+			check(requests.back().if_none_match == _feed_etag, "second request sends If-None-Match");
+			check(requests.back().if_modified_since == _feed_last_modified, "second request sends If-Modified-Since");
+		}
+
+		check(feed_transfers[_feed_name].response_code == 304, "second download gets 304");
+	}
+
+	gautier::rss_model::unit_type_rss_metrics second_metrics;
+
+	gautier::rss_model::load_metrics(second_metrics);
+
+	check(get_feed_stage_count(second_metrics, "parse") == get_feed_stage_count(first_metrics, "parse"), "304 response is not parsed");
+	check(get_feed_stage_count(second_metrics, "staging_insert") == get_feed_stage_count(first_metrics, "staging_insert"), "304 response is not staged");
+	check(get_stage_count(second_metrics, "merge") == get_stage_count(first_metrics, "merge"), "304 response is not saved");
+
+	{
+		gautier::rss_model::load_feeds_source_list(feed_sources);
+
+		check(feed_sources[_feed_name].etag == _feed_etag, "ETag is kept after 304");
+
+		std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> rss_feed_items;
+
+		gautier::rss_model::load_feed(_feed_name, rss_feed_items);
+
+		check(rss_feed_items[_feed_name].size() == 2, "saved items are kept after 304");
+	}
+
+	//Coded bodies: a gzip body of two members, received a byte at a time, a gzip body followed by zero padding,
+	//	and an encoding that cannot be decoded.
+	std::ofstream(coded_feeds_list_file_name)
+	<< _gzip_feed_name << "\thttp://127.0.0.1:" << server.port << "/gzip.xml\n"
+	<< _padded_gzip_feed_name << "\thttp://127.0.0.1:" << server.port << "/padded_gzip.xml\n"
+	<< _unsupported_feed_name << "\thttp://127.0.0.1:" << server.port << "/compress.xml\n";
+
+	std::map<std::string, gautier::rss_model::unit_type_rss_source> coded_feed_sources;
+
+	gautier::rss_model::load_feeds_source_list(coded_feeds_list_file_name, coded_feed_sources);
+
+	gautier::rss_model::collect_feeds(coded_feed_sources);
+
+	{
+		std::map<std::string, gautier::rss_model::unit_type_feed_transfer> feed_transfers;
+
+		gautier::rss_model::load_feed_transfers(feed_transfers);
+
+		check(feed_transfers[_gzip_feed_name].content_encoding == "gzip", "gzip body is decoded by the feed download");
+		check(feed_transfers[_gzip_feed_name].bytes_decoded == static_cast<long long>(get_coded_feed_document("/coded/").size()), "every gzip member is decoded");
+
+		std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> rss_feed_items;
+
+		gautier::rss_model::load_feed(_gzip_feed_name, rss_feed_items);
+
+		check(rss_feed_items[_gzip_feed_name].size() == 2, "items of the gzip body are saved");
+
+		gautier::rss_model::load_feed(_padded_gzip_feed_name, rss_feed_items);
+
+		check(rss_feed_items[_padded_gzip_feed_name].size() == 2, "zero padding after a gzip body is ignored");
+
+		gautier::rss_model::load_feed(_unsupported_feed_name, rss_feed_items);
+
+		check(rss_feed_items[_unsupported_feed_name].empty(), "body with an unknown Content-Encoding is not saved");
+
+		gautier::rss_model::load_feeds_source_list(coded_feed_sources);
+
+		check(coded_feed_sources[_unsupported_feed_name].next_due > static_cast<long long>(std::time(nullptr)), "unknown Content-Encoding fails the download");
+	}
+
+	gautier::rss_model::close_feeds_storage();
+
+	stop_loopback_server(server);
+
+	for(const std::string suffix : {"", "-wal", "-shm", "-journal"})
+	{
+		std::remove((database_file_name + suffix).data());
+	}
+
+	std::remove(feeds_list_file_name.data());
+	std::remove(coded_feeds_list_file_name.data());
+
+	rmdir(directory_name.data());
+
+	std::cout << ((_failure_count == 0) ? "all checks passed\n" : std::to_string(_failure_count) + " checks failed\n");
+
+	return (_failure_count == 0) ? 0 : 1;
+}
+
+/*Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0 . Software distributed under the License is distributed on an "AS IS" BASIS, NO WARRANTIES OR CONDITIONS OF ANY KIND, explicit or implicit. See the License for details on permissions and limitations.*/
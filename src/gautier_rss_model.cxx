@@ -1,13 +1,24 @@
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <map>
 
+#include <brotli/decode.h>
+#include <curl/curl.h>
 #include <sqlite3.h>
+#include <zlib.h>
 
 //#include "gautier_diagnostics.hxx"
 #include "gautier_rss_model.hxx"
@@ -15,6 +26,7 @@
 #include <cstdio>
 #include <libxml2/libxml/parser.h>
 #include <libxml2/libxml/tree.h>
+#include <libxml2/libxml/xmlreader.h>
 
 //Module level types and type aliases.
 enum parameter_data_type
@@ -24,13 +36,33 @@ enum parameter_data_type
 	integer
 };
 
+//Content encodings the feed download can decode.
+enum feed_content_coding
+{
+	coding_identity,
+	coding_zlib,
+	coding_brotli,
+	//Any other Content-Encoding. The download fails rather than reading the encoded body as XML.
+	coding_unsupported
+};
+
+//Outcome of reading one feed source.
+enum feed_fetch_status
+{
+	fetch_failed,
+	fetch_collected,
+	//The server reported the feed unchanged since the saved ETag or Last-Modified value.
+	fetch_not_modified,
+	//Not read, or the download was abandoned, once the caller of collect_feeds asked it to stop. The feed keeps its schedule.
+	fetch_stopped
+};
+
 //Implementation, module level variables.
 
 static constexpr bool 
 	_sql_trace_enabled = false,
 	_rows_affected_output_enabled = false,
-	_issued_sql_output_enabled = false,
-	_query_values_translator_output_enabled = false
+	_issued_sql_output_enabled = false
 ;
 
 static bool 
@@ -45,17 +77,112 @@ static const char
 ;
 
 static constexpr int 
-	_list_reserve_size = 200
+	_list_reserve_size = 200,
+	_db_busy_timeout_milliseconds = 5000,
+	//Shared by the document tree and streaming readers so both see the same content.
+	_xml_parse_options = (XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS | XML_PARSE_NOCDATA)
+;
+
+static constexpr long 
+	_fetch_connect_timeout_seconds = 30,
+	//A download slower than 1 byte per second for this long is abandoned.
+	_fetch_stall_timeout_seconds = 60,
+	_fetch_max_redirects = 5,
+	_fetch_wait_milliseconds = 1000
+;
+
+static constexpr long long 
+	//Bounds on the refresh interval learned from the publication dates of a feed.
+	_refresh_min_seconds = 15 * 60,
+	_refresh_max_seconds = 24 * 60 * 60,
+	//Used until a feed has at least two dated items.
+	_refresh_default_seconds = 60 * 60,
+	//Wait before trying a feed again after it could not be read.
+	_refresh_retry_seconds = 15 * 60,
+	//Most recent items whose publication dates are used to learn the interval.
+	_refresh_history_size = 20
+;
+
+//Feed items written to rss_feed_data_staging by one statement.
+//Five parameters a row keeps a batch within the 999 parameter limit of older SQLite builds.
+static constexpr int 
+	_staging_batch_size = 64
+;
+
+static int 
+	//Upper bound on worker threads used by collect_feed_items_from_rss.
+	_collect_max_connections = 8,
+	//Upper bound on simultaneous requests to the same host.
+	_collect_max_connections_per_host = 2
 ;
 
 static const std::string 
-	_element_name_item = "item",
-	_rss_database_name = "rss_feeds_info.db"
+	_fetch_user_agent = "gautier_rss",
+	_fetch_accept_encoding = "Accept-Encoding: gzip, deflate, br"
 ;
 
 static const std::vector<std::string> 
-	_element_names = {"title", "link", "description", "pubdate"},
-	_table_names = {"rss_feed_source", "rss_feed_data", "rss_feed_data_staging"}
+	_table_names = {"rss_feed_source", "rss_feed_data", "rss_feed_data_staging"},
+	//Full text index of feed item titles and descriptions for search_feed_items. Made by db_prepare_search_index.
+	//	The index reads its text from rss_feed_data. The triggers keep it in step as feed items are saved and purged.
+	_search_index_statements = {
+		"CREATE VIRTUAL TABLE IF NOT EXISTS rss_feed_data_search USING fts5(title, description, content='rss_feed_data', content_rowid='id');",
+		"INSERT INTO rss_feed_data_search(rss_feed_data_search) VALUES ('rebuild');",
+		"CREATE TRIGGER IF NOT EXISTS rss_feed_data_search_insert AFTER INSERT ON rss_feed_data BEGIN\
+			INSERT INTO rss_feed_data_search(rowid, title, description) VALUES (new.id, new.title, new.description);\
+		END;",
+		"CREATE TRIGGER IF NOT EXISTS rss_feed_data_search_delete AFTER DELETE ON rss_feed_data BEGIN\
+			INSERT INTO rss_feed_data_search(rss_feed_data_search, rowid, title, description) VALUES ('delete', old.id, old.title, old.description);\
+		END;",
+		"CREATE TRIGGER IF NOT EXISTS rss_feed_data_search_update AFTER UPDATE OF title, description ON rss_feed_data BEGIN\
+			INSERT INTO rss_feed_data_search(rss_feed_data_search, rowid, title, description) VALUES ('delete', old.id, old.title, old.description);\
+			INSERT INTO rss_feed_data_search(rowid, title, description) VALUES (new.id, new.title, new.description);\
+		END;"
+	},
+	_search_trigger_names = {"rss_feed_data_search_insert", "rss_feed_data_search_delete", "rss_feed_data_search_update"},
+	//Schema changes applied in order to new and existing databases by db_migrate_schema.
+	//Entry n brings a database to schema version n + 1, recorded in PRAGMA user_version.
+	//Only add to the end of this list.
+	_schema_migrations = {
+		//1: One row per link in rss_feed_data so the merge from staging can be an upsert.
+		//	Existing duplicate links are reduced to the earliest row before the unique index is made.
+		"DELETE FROM rss_feed_data WHERE id NOT IN (SELECT MIN(id) FROM rss_feed_data GROUP BY link);\
+		CREATE UNIQUE INDEX IF NOT EXISTS rss_feed_data_link_ux ON rss_feed_data(link);\
+		CREATE INDEX IF NOT EXISTS rss_feed_data_source_ix ON rss_feed_data(rss_feed_source_id);\
+		CREATE INDEX IF NOT EXISTS rss_feed_source_name_ix ON rss_feed_source(name);",
+		//2: HTTP cache validators, sent back with the next request for the feed.
+		"ALTER TABLE rss_feed_source ADD COLUMN etag TEXT NOT NULL DEFAULT '';\
+		ALTER TABLE rss_feed_source ADD COLUMN last_modified TEXT NOT NULL DEFAULT '';",
+		//3: Refresh schedule per feed source. next_due is in seconds since the epoch, 0 means due now.
+		//	ttl_minutes, skip_hours and skip_days keep the ttl, skipHours and skipDays elements of the channel.
+		"ALTER TABLE rss_feed_source ADD COLUMN next_due INTEGER NOT NULL DEFAULT 0;\
+		ALTER TABLE rss_feed_source ADD COLUMN ttl_minutes INTEGER NOT NULL DEFAULT 0;\
+		ALTER TABLE rss_feed_source ADD COLUMN skip_hours INTEGER NOT NULL DEFAULT 0;\
+		ALTER TABLE rss_feed_source ADD COLUMN skip_days INTEGER NOT NULL DEFAULT 0;",
+		//4: Feed items in the order they are loaded, so a page of a feed is read from the index without sorting.
+		//	Ties on pub_date are ordered by id, which an index keeps after its columns.
+		//	Replaces the index on rss_feed_source_id alone.
+		"CREATE INDEX IF NOT EXISTS rss_feed_data_source_pub_date_ix ON rss_feed_data(rss_feed_source_id, pub_date);\
+		DROP INDEX IF EXISTS rss_feed_data_source_ix;",
+		//5: Was the full text index for search_feed_items. It needs SQLite built with FTS5,
+		//	so it is now made outside of the schema versions by db_prepare_search_index.
+		"SELECT 1;",
+		//6: Publication dates as seconds since the epoch, so feed items sort in time rather than by the text of the date.
+		//	Saved items are filled in by feed_date_epoch, which every connection registers. 0 when the date could not be read.
+		//	The search update trigger of earlier versions is dropped first, so the fill does not rewrite the search index.
+		//	db_prepare_search_index puts it back, limited to the searched columns.
+		//	Replaces the index on the pub_date text.
+		"DROP TRIGGER IF EXISTS rss_feed_data_search_update;\
+		ALTER TABLE rss_feed_data ADD COLUMN pub_date_epoch INTEGER NOT NULL DEFAULT 0;\
+		ALTER TABLE rss_feed_data_staging ADD COLUMN pub_date_epoch INTEGER NOT NULL DEFAULT 0;\
+		UPDATE rss_feed_data SET pub_date_epoch = feed_date_epoch(pub_date);\
+		CREATE INDEX IF NOT EXISTS rss_feed_data_source_pub_date_epoch_ix ON rss_feed_data(rss_feed_source_id, pub_date_epoch);\
+		DROP INDEX IF EXISTS rss_feed_data_source_pub_date_ix;",
+		//7: Days feed items of a source are kept by purge_feeds, 0 for the default passed to it.
+		//	Saved items are found by source and time saved, so each batch of a purge is a range of the index.
+		"ALTER TABLE rss_feed_source ADD COLUMN retention_days INTEGER NOT NULL DEFAULT 0;\
+		CREATE INDEX IF NOT EXISTS rss_feed_data_source_entry_date_ix ON rss_feed_data(rss_feed_source_id, entry_date);"
+	}
 ;
 
 static std::vector<std::tuple<std::string, std::string, parameter_data_type>> 
@@ -64,46 +191,343 @@ static std::vector<std::tuple<std::string, std::string, parameter_data_type>>
 	}
 ;
 
+//Prepared statements for each open connection, keyed by the sql text that produced them.
+//Statements are reset after each use and finalized when the connection closes.
+static std::map<sqlite3*, std::map<std::string, sqlite3_stmt*>> 
+	_db_statement_cache
+;
+
+static std::mutex 
+	_db_statement_cache_lock
+;
+
+//Transfer of the last download of each feed, by feed name. Written by the collect workers.
+static std::map<std::string, gautier::rss_model::unit_type_feed_transfer> 
+	_feed_transfers
+;
+
+static std::mutex 
+	_feed_transfers_lock
+;
+
+//See set_metrics_enabled.
+static std::atomic<bool> 
+	_metrics_enabled{false}
+;
+
+static gautier::rss_model::unit_type_rss_metrics 
+	_metrics
+;
+
+static std::mutex 
+	_metrics_lock
+;
+
+//Database connections kept open for the life of the process.
+//Keeping them open preserves the page cache and the prepared statement cache between calls.
+//Each connection is leased to one caller at a time. Another is opened when all are leased.
+struct db_connection_pool
+{
+	std::mutex 
+		lock
+	;
+
+	std::vector<sqlite3*> 
+		idle_connections
+	;
+
+	bool 
+		//Set once the tables have been confirmed on the first connection.
+		tables_exist = false,
+		//Set with tables_exist. False when SQLite was built without FTS5.
+		search_available = false
+	;
+
+	gautier::rss_model::unit_type_storage_settings 
+		//Applied to each connection as it is opened.
+		storage_settings
+	;
+
+	~db_connection_pool();
+};
+
+static db_connection_pool 
+	_db_connection_pool
+;
+
 using type_list_size = std::vector<void*>::size_type;
 
+//Reads one result row by column index. Called by apply_sql for each row returned.
+using type_row_reader = std::function<void(sqlite3_stmt*)>;
+
+//Receives the items of one feed source as soon as they are collected.
+//Called by collect_feed_items_from_rss on its own thread, one feed at a time.
+//The feed source carries the cache validators of the download.
+using type_feed_collected = std::function<void(const gautier::rss_model::unit_type_rss_source& feed_source, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)>;
+
+//Shared by the workers of collect_feed_items_from_rss.
+//Tracks which feed sources have been handed out and how many requests each host has open.
+struct feed_collect_schedule
+{
+	std::mutex 
+		lock
+	;
+
+	std::condition_variable 
+		host_released,
+		feed_completed
+	;
+
+	std::vector<char> 
+		taken
+	;
+
+	std::vector<std::string> 
+		hosts
+	;
+
+	//Feed sources finished by a worker but not yet handed to the caller.
+	std::vector<type_list_size> 
+		completed
+	;
+
+	std::map<std::string, int> 
+		host_connections
+	;
+
+	type_list_size 
+		remaining = 0
+	;
+
+	//Set by the caller of collect_feeds to skip the feeds not yet started. Null when it cannot be stopped.
+	const std::atomic<bool>* 
+		stop_requested = nullptr
+	;
+};
+
+//Channel elements that limit how often a feed should be downloaded.
+struct feed_refresh_hints
+{
+	int 
+		ttl_minutes = 0,
+		//Bit n is set for hour n, GMT.
+		skip_hours = 0,
+		//Bit n is set for day n, counting from Sunday.
+		skip_days = 0
+	;
+};
+
+//Element names the feed readers act on. Matched regardless of letter case by get_feed_element_name.
+enum feed_element_name 
+{
+	element_other,
+	element_item,
+	element_title,
+	element_link,
+	element_description,
+	element_pubdate,
+	element_ttl,
+	element_skiphours,
+	element_hour,
+	element_skipdays,
+	element_day,
+	//Root elements.
+	element_rss,
+	element_rdf,
+	element_feed,
+	//RSS 1.0 item date, from the Dublin Core namespace.
+	element_date,
+	//Atom entries.
+	element_entry,
+	element_id,
+	element_summary,
+	element_content,
+	element_published,
+	element_updated
+};
+
+//Feed document formats, told apart by the root element.
+enum feed_format 
+{
+	//RSS 0.9x and 2.0. Also used for documents with an unexpected root element.
+	format_rss,
+	//RSS 1.0, with an RDF root element. Items sit beside the channel rather than in it.
+	format_rdf,
+	//Atom 1.0.
+	format_atom
+};
+
+//One feed download, shared by the curl callbacks and the xml reader callbacks.
+//The transfer only advances when the xml reader asks for more input,
+//	so the document is parsed as it arrives and is never held in memory whole.
+struct feed_download
+{
+	CURL* 
+		transfer = nullptr
+	;
+
+	CURLM* 
+		transfer_driver = nullptr
+	;
+
+	std::string 
+		//Received but not yet given to the xml reader.
+		received,
+		etag,
+		last_modified
+	;
+
+	std::string::size_type 
+		received_offset = 0
+	;
+
+	bool 
+		finished = false
+	;
+
+	CURLcode 
+		result = CURLE_OK
+	;
+
+	//Abandons the transfer once set, see feed_download_advance. Null when it cannot be stopped.
+	const std::atomic<bool>* 
+		stop_requested = nullptr
+	;
+
+	//Compressed bodies are decoded here rather than by curl, so the bytes received and the decode time can be measured.
+	std::string 
+		content_encoding
+	;
+
+	feed_content_coding 
+		content_coding = coding_identity
+	;
+
+	z_stream 
+		zlib_decoder{}
+	;
+
+	BrotliDecoderState* 
+		brotli_decoder = nullptr
+	;
+
+	bool 
+		decoder_ready = false,
+		decoder_finished = false,
+		//Set once the decoder is ready. gzip bodies may hold several members, decoded one after the other.
+		decoder_gzip = false,
+		//Set when what follows a gzip member is not another member, such as zero padding. The rest of the body is ignored.
+		decoder_trailer = false
+	;
+
+	//The start of a zlib coded body, or of what follows a gzip member,
+	//	kept until its first two bytes tell which header it has.
+	std::string 
+		decoder_lead
+	;
+
+	long long 
+		bytes_received = 0,
+		bytes_decoded = 0
+	;
+
+	std::chrono::steady_clock::duration 
+		decode_time{0},
+		//Spent running the transfer, decoding included.
+		network_time{0}
+	;
+};
+
 //Implementation, general support functions.
 static int switch_letter_case (const char& in_char);
+static std::string get_url_host(const std::string& url);
+static bool parse_feed_date(const std::string& date_text, long long& seconds_since_epoch);
+static bool parse_rfc822_date(const std::string& date_text, long long& seconds_since_epoch);
+static bool parse_rfc3339_date(const std::string& date_text, long long& seconds_since_epoch);
+static long long get_days_from_civil(long long year, const unsigned month, const unsigned day);
 
 //Implementation, top-level logic
 //Largely SQL API dependent.
 static void filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, std::map<std::string, gautier::rss_model::unit_type_rss_source>& final_feed_sources);
-static void save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
-static void make_feed_item(std::map<std::string, std::string>& row_of_data, gautier::rss_model::unit_type_rss_item& feed_item);
+static void save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items, const std::map<std::string, gautier::rss_model::unit_type_rss_source>& collected_sources);
+static std::string make_staging_insert_text(const int row_count);
+static std::string get_entry_date_text(const std::time_t entry_time);
+static void stage_feed_items(sqlite3** db_connection, const int rss_feed_source_id, const std::vector<gautier::rss_model::unit_type_rss_item>& feed_items);
+static void schedule_feeds(const std::vector<gautier::rss_model::unit_type_rss_source>& fetched_sources, const std::vector<feed_fetch_status>& fetch_statuses);
+static long long get_refresh_due_time(const gautier::rss_model::unit_type_rss_source& feed_source, std::vector<long long> pub_times, const long long now);
+static void make_feed_item(sqlite3_stmt* sql_stmt, gautier::rss_model::unit_type_rss_item& feed_item);
+static void add_feed_item_row(sqlite3_stmt* sql_stmt, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>::iterator& feed_position);
+static void make_feed_items_query(std::string& sql_text);
+static void make_feed_items_query(const gautier::rss_model::unit_type_rss_source& feed_source, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values);
+static void make_feed_page_query(const gautier::rss_model::unit_type_rss_source& feed_source, const int page_size, const gautier::rss_model::unit_type_feed_page_cursor& cursor, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values);
+static void visit_feed_items(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values, const gautier::rss_model::type_feed_item_visitor& feed_item_visitor);
+static std::string make_search_match_text(const std::string& search_text);
+static long long purge_rows(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values, const int batch_size);
 
 //Implementation, supporting logic.
 //XML API dependent
 //Takes a source of data, defined in the XML format, using the RSS 1.0 schema
-//	and converts it to various application defined data structures.
-//*These output data structures drive the entire rss engine.
-//*	std::map<std::string, std::vector<std::map<std::string, std::string>>> and std::vector<std::map<std::string, std::string>> are the main data structures.
-static void collect_feed_items_from_rss(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
+//	and converts it to the feed items of each feed source.
+//*Each feed source is handed to a type_feed_collected callback, with its feed items, as soon as it is read.
+//*	The callback saves them, so the rss engine never holds the items of every feed at once.
+static bool is_stop_requested(const std::atomic<bool>* stop_requested);
+static void collect_feed_items_from_rss(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, const type_feed_collected& feed_collected, std::vector<gautier::rss_model::unit_type_rss_source>& fetched_sources, std::vector<feed_fetch_status>& fetch_statuses, const std::atomic<bool>* stop_requested);
+static void collect_feed_items_worker(feed_collect_schedule& schedule, std::vector<gautier::rss_model::unit_type_rss_source>& pending_sources, std::vector<std::vector<gautier::rss_model::unit_type_rss_item>>& collected_items, std::vector<feed_fetch_status>& fetch_statuses);
+static void init_feed_readers();
+static feed_fetch_status collect_feed_items_from_source(gautier::rss_model::unit_type_rss_source& feed_source, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, const std::atomic<bool>* stop_requested);
+static feed_fetch_status collect_feed_items_from_network(gautier::rss_model::unit_type_rss_source& feed_source, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, const std::atomic<bool>* stop_requested);
+static bool collect_feed_items_from_document(const std::string& feed_url, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items);
+static bool collect_feed_items_from_stream(const std::string& feed_url, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, feed_refresh_hints& refresh_hints);
 static void collect_feed_items(xmlNode* xml_element, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items);
-static std::string get_string_from_xmlchar(const xmlChar* xstring_in, decltype(switch_letter_case) transform_func);
-static bool is_an_approved_rss_data_name(const std::string& element_name);
+static bool collect_feed_items(xmlTextReaderPtr xml_reader, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, feed_refresh_hints& refresh_hints);
+static void collect_rss_items(xmlTextReaderPtr xml_reader, const feed_format format, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, feed_refresh_hints& refresh_hints);
+static void collect_atom_entries(xmlTextReaderPtr xml_reader, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items);
+static void append_text(xmlTextReaderPtr xml_reader, const int node_type, std::string* data_target);
+static bool get_attribute_value(xmlTextReaderPtr xml_reader, const char* attribute_name, std::string& value);
+static feed_element_name get_feed_element_name(const xmlChar* element_name);
+static std::string* get_feed_item_field(const feed_element_name element_name, gautier::rss_model::unit_type_rss_item& feed_item);
+static void apply_refresh_hint(const feed_element_name element_name, const std::string& element_value, feed_refresh_hints& refresh_hints);
+
+//Network API dependent
+static bool is_network_location(const std::string& feed_url);
+static bool feed_download_advance(feed_download& download);
+static std::size_t feed_download_write(char* data, std::size_t size, std::size_t count, void* context);
+static std::size_t feed_download_header(char* data, std::size_t size, std::size_t count, void* context);
+static int feed_download_read(void* context, char* buffer, int length);
+static int feed_download_close(void*);
+static bool feed_download_decode(feed_download& download, const char* data, const std::size_t data_size);
+static void feed_download_end_decode(feed_download& download);
+static void save_feed_transfer(const std::string& feed_name, const feed_download& download, const long response_code);
+
+//Metrics
+static void record_stage_time(const std::string& stage_name, const std::string& feed_name, const std::chrono::steady_clock::duration elapsed);
+static void record_feed_counts(const std::string& feed_name, const gautier::rss_model::unit_type_feed_metrics& feed_counts);
+static void add_stage_time(gautier::rss_model::unit_type_stage_metrics& stage_metrics, const long long microseconds);
+static void output_stage_metrics(std::ostream& metrics_output, const gautier::rss_model::unit_type_stage_metrics& stage_metrics);
 
 //SQL: Database infrastructure/tables.
 static void db_connection_guard_finalize(sqlite3* obj);
+static void db_connection_guard_release(sqlite3* obj);
+static bool db_lease_connection(sqlite3** db_connection);
+static void db_close_idle_connections();
 static bool db_check_database_exist(sqlite3** db_connection);
+static void db_apply_storage_settings(sqlite3** db_connection);
+static void db_feed_date_epoch(sqlite3_context* sql_context, int argument_count, sqlite3_value** argument_values);
 static bool db_check_tables_exist(sqlite3** db_connection);
 static bool db_create_table(sqlite3** db_connection, const std::string& table_name);
+static bool db_migrate_schema(sqlite3** db_connection);
+static bool db_prepare_search_index(sqlite3** db_connection);
 static bool db_transact_begin(sqlite3** db_connection);
 static bool db_transact_end(sqlite3** db_connection);
+static sqlite3_stmt* db_get_statement(sqlite3** db_connection, const std::string& sql_text);
+static void db_release_statements(sqlite3* db_connection);
 
 //SQL: Transformation
-static int translate_sql_result(void* user_defined_data, int column_count, char** column_values, char** column_names);
-static bool translate_sql_result(std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values, sqlite3_stmt* sql_stmt);
-static std::pair<bool, int> apply_sql(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_binding_infos, std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values);
-static std::string get_first_db_column_value(const std::map<std::string, std::string>& row_of_data, const std::string& col_name);
+static std::pair<bool, int> apply_sql(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_binding_infos, const type_row_reader& row_reader);
+static void get_column_text(sqlite3_stmt* sql_stmt, const int column_index, std::string& value);
 static std::tuple<std::string, std::string, parameter_data_type> create_binding(const std::string name, const std::string value, const parameter_data_type parameter_type);
 
 //SQL: Diagnostics
-static void output_data_rows(const std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values);
-
 static void enable_op_sql_trace(sqlite3** db_connection);
 static void trace_sql_op(void*, const char*);
 
@@ -124,6 +548,7 @@ static void output_op_sql_error_message(sqlite3** db_connection, const int& line
 //This function is optional and is one form of a solution for deriving the output.
 //This function deals with a plain-text file. The file format has 
 //	the name of the feed in column 1 and the rss feed url in column 2. 
+//	An optional column 3 gives the days its items are kept, see purge_feeds.
 //	Each column is separated by a tab.
 //This version reads all lines into a data structure to be fed into collect_feed_items_from_rss function.
 //Since the number of lines will not exceed a 100 or 200 lines, this approach is acceptable. 
@@ -162,8 +587,15 @@ gautier::rss_model::load_feeds_source_list(const std::string& feeds_list_file_na
 						gautier::rss_model::unit_type_rss_source 
 						rss_source;
 
+						const auto url_end = line_data.find(_feed_config_line_sep, tab_pos+1);
+
 						rss_source.name = std::string(line_data, 0, tab_pos);
-						rss_source.url = std::string(line_data, tab_pos+1, std::string::npos);
+						rss_source.url = std::string(line_data, tab_pos+1, (url_end == std::string::npos) ? std::string::npos : url_end - tab_pos - 1);
+
+						if(url_end != std::string::npos)
+						{
+							rss_source.retention_days = std::max(0, std::atoi(line_data.data() + url_end + 1));
+						}
 
 						tmp_feed_sources[rss_source.name] = rss_source;
 					}
@@ -191,6 +623,15 @@ gautier::rss_model::load_feeds_source_list(std::map<std::string, gautier::rss_mo
 	return;
 }
 
+void 
+gautier::rss_model::set_collect_concurrency(const int max_connections, const int max_connections_per_host)
+{
+	_collect_max_connections = std::max(1, max_connections);
+	_collect_max_connections_per_host = std::max(1, max_connections_per_host);
+
+	return;
+}
+
 //Main logic.
 //Ties together the process of pulling in rss feed data (in XML format) 
 //	into a data structure named std::map<std::string, std::vector<std::map<std::string, std::string>>> that is used 
@@ -201,10 +642,60 @@ gautier::rss_model::collect_feeds(const std::map<std::string, gautier::rss_model
 	if(!feed_sources.empty())
 	{
 		std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> rss_feed_items;
+		std::map<std::string, gautier::rss_model::unit_type_rss_source> collected_sources;
+
+		std::vector<gautier::rss_model::unit_type_rss_source> fetched_sources;
+		std::vector<feed_fetch_status> fetch_statuses;
+
+		collect_feed_items_from_rss(feed_sources, [&rss_feed_items, &collected_sources](const gautier::rss_model::unit_type_rss_source& feed_source, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)
+		{
+			rss_feed_items[feed_source.name] = std::move(feed_items);
+			collected_sources[feed_source.name] = feed_source;
+		}, fetched_sources, fetch_statuses, nullptr);
+
+		save_feeds(rss_feed_items, collected_sources);
+
+		schedule_feeds(fetched_sources, fetch_statuses);
+	}
+
+	return;
+}
+
+void 
+gautier::rss_model::collect_feeds(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, const std::function<void(const std::string& feed_name)>& feed_saved)
+{
+	const std::atomic<bool> stop_requested{false};
+
+	collect_feeds(feed_sources, feed_saved, stop_requested);
+
+	return;
+}
+
+void 
+gautier::rss_model::collect_feeds(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, const std::function<void(const std::string& feed_name)>& feed_saved, const std::atomic<bool>& stop_requested)
+{
+	if(!feed_sources.empty())
+	{
+		std::vector<gautier::rss_model::unit_type_rss_source> fetched_sources;
+		std::vector<feed_fetch_status> fetch_statuses;
+
+		collect_feed_items_from_rss(feed_sources, [&feed_saved](const gautier::rss_model::unit_type_rss_source& feed_source, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)
+		{
+			std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> rss_feed_items;
+			std::map<std::string, gautier::rss_model::unit_type_rss_source> collected_sources;
 
-		collect_feed_items_from_rss(feed_sources, rss_feed_items);
+			rss_feed_items[feed_source.name] = std::move(feed_items);
+			collected_sources[feed_source.name] = feed_source;
+
+			save_feeds(rss_feed_items, collected_sources);
+
+			if(feed_saved)
+			{
+				feed_saved(feed_source.name);
+			}
+		}, fetched_sources, fetch_statuses, &stop_requested);
 
-		save_feeds(rss_feed_items);
+		schedule_feeds(fetched_sources, fetch_statuses);
 	}
 
 	return;
@@ -223,6 +714,8 @@ gautier::rss_model::collect_feeds(const std::map<std::string, gautier::rss_model
 void 
 gautier::rss_model::load_feeds(std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
 {
+	const auto load_start = std::chrono::steady_clock::now();
+
 	std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> tmp_rss_feed_items;
 
 	if(!rss_feed_items.empty())
@@ -232,11 +725,11 @@ gautier::rss_model::load_feeds(std::map<std::string, std::vector<gautier::rss_mo
 
 	sqlite3* db_connection = nullptr;
 
-	db_check_database_exist(&db_connection);
+	db_lease_connection(&db_connection);
 
 	if(db_connection)
 	{
-		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_finalize);
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
 
 		//optimization
 		//preallocate feed items in contiguous groups.
@@ -252,86 +745,109 @@ gautier::rss_model::load_feeds(std::map<std::string, std::vector<gautier::rss_mo
 			ORDER BY fs.name;\
 			";
 
-			std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values;
-			query_values.reset(new std::vector<std::map<std::string, std::string>>);
+			apply_sql(&db_connection, sql_text, _empty_param_set, [&tmp_rss_feed_items](sqlite3_stmt* sql_stmt)
+			{
+				std::string feed_name;
 
-			char* error_message = 0;
+				get_column_text(sql_stmt, 0, feed_name);
 
-			const auto sqlite_result = 
-			sqlite3_exec(db_connection, sql_text.data(), translate_sql_result, query_values.get(), &error_message);
+				const auto item_count = 
+				static_cast<type_list_size>(sqlite3_column_int64(sql_stmt, 1));
 
-			if(sqlite_result == SQLITE_OK)
-			{
-				if(query_values)
-				{
-					for(auto& row_of_data : *query_values)
-					{
-						const std::string feed_name = row_of_data["name"];
-						const type_list_size item_count = std::stoul(row_of_data["total_sub_items"]);
+				tmp_rss_feed_items[feed_name].reserve(item_count);
+			});
+		}
 
-						auto feed_items = &(tmp_rss_feed_items[feed_name]);
+		//load the feed detail.
+		{
+			std::string 
+			sql_text{};
 
-						feed_items->reserve(item_count);
-					}
-				}
-			}
-			else
+			make_feed_items_query(sql_text);
+
+			auto feed_position = tmp_rss_feed_items.end();
+
+			apply_sql(&db_connection, sql_text, _empty_param_set, [&tmp_rss_feed_items, &feed_position](sqlite3_stmt* sql_stmt)
 			{
-				output_op_sql_error_message(&error_message, __LINE__);
-			}
+				add_feed_item_row(sql_stmt, tmp_rss_feed_items, feed_position);
+			});
 		}
+	}
 
-		//load the feed detail.
+	rss_feed_items = std::move(tmp_rss_feed_items);
+
+	record_stage_time("load_feeds", "", std::chrono::steady_clock::now() - load_start);
+
+	return;
+}
+
+void 
+gautier::rss_model::load_feeds_since(long long& watermark, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+{
+	const auto load_start = std::chrono::steady_clock::now();
+
+	std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> tmp_rss_feed_items;
+
+	if(!rss_feed_items.empty())
+	{
+		rss_feed_items.clear();
+	}
+
+	long long tmp_watermark = watermark;
+
+	sqlite3* db_connection = nullptr;
+
+	db_lease_connection(&db_connection);
+
+	if(db_connection)
+	{
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
+
+		//load the feed detail added after the watermark.
+		//fd.id is the rowid, so only the new rows are visited before sorting.
 		{
 			std::string 
 			sql_text = 
 			"SELECT \
 				fs.name AS feed_name, \
+				fd.id, \
 				fd.pub_date, \
 				fd.title, \
 				fd.link, \
-				fd.description \
-			FROM rss_feed_source AS fs INNER JOIN \
-			rss_feed_data AS fd ON fs.id = fd.rss_feed_source_id \
+				fd.description, \
+				fd.pub_date_epoch \
+			FROM rss_feed_data AS fd INNER JOIN \
+			rss_feed_source AS fs ON fs.id = fd.rss_feed_source_id \
+			WHERE fd.id > @watermark \
 			ORDER BY \
 				 fs.name, \
-				 fd.pub_date, \
-				 fd.title;\
+				 fs.id, \
+				 fd.pub_date_epoch, \
+				 fd.id;\
 			";
 
-			std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values;
-			query_values.reset(new std::vector<std::map<std::string, std::string>>);
-
-			char* error_message = 0;
-
-			const auto sqlite_result = 
-			sqlite3_exec(db_connection, sql_text.data(), translate_sql_result, query_values.get(), &error_message);
-
-			if(sqlite_result == SQLITE_OK)
+			std::vector<std::tuple<std::string, std::string, parameter_data_type>> 
+			parameter_values = 
 			{
-				if(query_values && !query_values->empty())
-				{
-					for(auto& row_of_data : *query_values)
-					{
-						const std::string 
-						feed_name = row_of_data["feed_name"];
-
-						gautier::rss_model::unit_type_rss_item feed_item;
+				create_binding("@watermark", std::to_string(watermark), parameter_data_type::integer)
+			};
 
-						make_feed_item(row_of_data, feed_item);
+			auto feed_position = tmp_rss_feed_items.end();
 
-						tmp_rss_feed_items[feed_name].push_back(feed_item);
-					}
-				}
-			}
-			else
+			apply_sql(&db_connection, sql_text, parameter_values, [&tmp_rss_feed_items, &feed_position, &tmp_watermark](sqlite3_stmt* sql_stmt)
 			{
-				output_op_sql_error_message(&error_message, __LINE__);
-			}
+				add_feed_item_row(sql_stmt, tmp_rss_feed_items, feed_position);
+
+				tmp_watermark = std::max(tmp_watermark, static_cast<long long>(sqlite3_column_int64(sql_stmt, 1)));
+			});
 		}
 	}
 
-	rss_feed_items = tmp_rss_feed_items;
+	rss_feed_items = std::move(tmp_rss_feed_items);
+
+	watermark = tmp_watermark;
+
+	record_stage_time("load_feeds_since", "", std::chrono::steady_clock::now() - load_start);
 
 	return;
 }
@@ -348,11 +864,11 @@ gautier::rss_model::load_feed(const gautier::rss_model::unit_type_rss_source& fe
 
 	sqlite3* db_connection = nullptr;
 
-	db_check_database_exist(&db_connection);
+	db_lease_connection(&db_connection);
 
 	if(db_connection)
 	{
-		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_finalize);
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
 
 		//load the feed detail.
 		{
@@ -362,138 +878,487 @@ gautier::rss_model::load_feed(const gautier::rss_model::unit_type_rss_source& fe
 			std::vector<std::tuple<std::string, std::string, parameter_data_type>> 
 			parameter_values;
 
-			if(feed_source.id > 0)
-			{
-				sql_text = 
-				"SELECT \
-					fs.name AS feed_name, \
-					fd.pub_date, \
-					fd.title, \
-					fd.link, \
-					fd.description \
-				FROM rss_feed_source AS fs INNER JOIN \
-				rss_feed_data AS fd ON fs.id = fd.rss_feed_source_id \
-				WHERE fs.id = @id \
-				ORDER BY \
-					 fd.pub_date, \
-					 fd.title;\
-				";
+			make_feed_items_query(feed_source, sql_text, parameter_values);
 
-				auto sql_param_binding = 
-				create_binding("@id", std::to_string(feed_source.id), parameter_data_type::integer);
+			auto feed_position = tmp_rss_feed_items.end();
 
-				parameter_values.push_back(sql_param_binding);
-			}
-			else if(!feed_source.name.empty())
+			apply_sql(&db_connection, sql_text, parameter_values, [&tmp_rss_feed_items, &feed_position](sqlite3_stmt* sql_stmt)
 			{
-				sql_text = 
-				"SELECT \
-					fs.name AS feed_name, \
-					fd.pub_date, \
-					fd.title, \
-					fd.link, \
-					fd.description \
-				FROM rss_feed_source AS fs INNER JOIN \
-				rss_feed_data AS fd ON fs.id = fd.rss_feed_source_id \
-				WHERE fs.name = @feed_name \
-				ORDER BY \
-					 fd.pub_date, \
-					 fd.title;\
-				";
+				add_feed_item_row(sql_stmt, tmp_rss_feed_items, feed_position);
+			});
+		}
+	}
 
-				auto sql_param_binding = 
-				create_binding("@feed_name", feed_source.name, parameter_data_type::text);
+	rss_feed_items = std::move(tmp_rss_feed_items);
 
-				parameter_values.push_back(sql_param_binding);
-			}
+	return;
+}
 
-			std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values;
-			query_values.reset(new std::vector<std::map<std::string, std::string>>);
+void 
+gautier::rss_model::load_feed(const std::string feed_source_name, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+{
+	gautier::rss_model::unit_type_rss_source 
+	feed_source;
 
-			apply_sql(&db_connection, sql_text, parameter_values, query_values);
+	feed_source.name = feed_source_name;
 
-			if(query_values && !query_values->empty())
-			{
-				for(auto& row_of_data : *query_values)
-				{
-					const std::string 
-					feed_name = row_of_data["feed_name"];
+	load_feed(feed_source, rss_feed_items);
 
-					gautier::rss_model::unit_type_rss_item feed_item;
+	return;
+}
 
-					make_feed_item(row_of_data, feed_item);
+void 
+gautier::rss_model::load_feed(const gautier::rss_model::unit_type_rss_source& feed_source, const int page_size, gautier::rss_model::unit_type_feed_page_cursor& cursor, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+{
+	std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> tmp_rss_feed_items;
 
-					tmp_rss_feed_items[feed_name].push_back(feed_item);
-				}
-			}
+	if(!rss_feed_items.empty())
+	{
+		rss_feed_items.clear();
+	}
+
+	sqlite3* db_connection = nullptr;
+
+	//A connection is only leased once there is a page to read, since the guard below returns it.
+	if(page_size > 0)
+	{
+		db_lease_connection(&db_connection);
+	}
+
+	if(db_connection)
+	{
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
+
+		//load one page of the feed detail.
+		{
+			std::string 
+			sql_text{};
+
+			std::vector<std::tuple<std::string, std::string, parameter_data_type>> 
+			parameter_values;
+
+			make_feed_page_query(feed_source, page_size, cursor, sql_text, parameter_values);
+
+			auto feed_position = tmp_rss_feed_items.end();
+
+			apply_sql(&db_connection, sql_text, parameter_values, [&tmp_rss_feed_items, &feed_position](sqlite3_stmt* sql_stmt)
+			{
+				add_feed_item_row(sql_stmt, tmp_rss_feed_items, feed_position);
+			});
+		}
+	}
+
+	//The next page starts after the last item of this one.
+	for(const auto& feed_items : tmp_rss_feed_items)
+	{
+		if(!feed_items.second.empty())
+		{
+			cursor.pub_date_epoch = feed_items.second.back().pub_date_epoch;
+			cursor.id = feed_items.second.back().id;
 		}
 	}
 
-	rss_feed_items = tmp_rss_feed_items;
+	rss_feed_items = std::move(tmp_rss_feed_items);
 
 	return;
 }
 
 void 
-gautier::rss_model::load_feed(const std::string feed_source_name, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+gautier::rss_model::load_feed(const std::string feed_source_name, const int page_size, gautier::rss_model::unit_type_feed_page_cursor& cursor, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
 {
 	gautier::rss_model::unit_type_rss_source 
 	feed_source;
 
 	feed_source.name = feed_source_name;
 
-	load_feed(feed_source, rss_feed_items);
+	load_feed(feed_source, page_size, cursor, rss_feed_items);
 
 	return;
 }
 
 void 
-gautier::rss_model::create_feed_items_list(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items, std::vector<unit_type_rss_item>& rss_items)
+gautier::rss_model::visit_feeds(const gautier::rss_model::type_feed_item_visitor& feed_item_visitor)
 {
-	for(const auto& named_list : rss_feed_items)
+	sqlite3* db_connection = nullptr;
+
+	db_lease_connection(&db_connection);
+
+	if(db_connection)
 	{
-		std::vector<gautier::rss_model::unit_type_rss_item> feed_list = named_list.second;
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
 
-		for(gautier::rss_model::unit_type_rss_item& feed_item : feed_list)
-		{
-			unit_type_rss_item rss_item;
+		std::string 
+		sql_text{};
 
-			rss_items.push_back(rss_item);
-		}
+		make_feed_items_query(sql_text);
 
-		break;
+		visit_feed_items(&db_connection, sql_text, _empty_param_set, feed_item_visitor);
 	}
 
 	return;
 }
 
-//Presents rss feed information to standard output.
-//An optional, convenience function primarily for diagnostic/testing purposes 
-//	but whose sequence can be adapted to other file based output processes.
-//One of those processes can involve converting the rss feed information into 
-//	HTML file format.
-//HTML output is not designed into this version, but would be a quick way 
-//	to put feeds into a format that can be immediately used in a web browser.
 void 
-gautier::rss_model::output_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+gautier::rss_model::visit_feed(const gautier::rss_model::unit_type_rss_source& feed_source, const gautier::rss_model::type_feed_item_visitor& feed_item_visitor)
 {
-	const std::string heading_line = "***********************************************";
+	sqlite3* db_connection = nullptr;
 
-	std::stringstream ostr;
+	db_lease_connection(&db_connection);
 
-	//each feed.
-	for(const auto& named_list : rss_feed_items)
+	if(db_connection)
 	{
-		const std::string& list_name = named_list.first;
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
 
-		ostr << heading_line << "\n";
-		ostr << "\t\t" << list_name << "\n";
-		ostr << heading_line << "\n";
+		std::string 
+		sql_text{};
 
-		std::vector<gautier::rss_model::unit_type_rss_item> feed_list = named_list.second;
+		std::vector<std::tuple<std::string, std::string, parameter_data_type>> 
+		parameter_values;
 
-		//Each value is an anonymous item that is a list of name/value pairs
-		for(gautier::rss_model::unit_type_rss_item& feed_item : feed_list)
+		make_feed_items_query(feed_source, sql_text, parameter_values);
+
+		visit_feed_items(&db_connection, sql_text, parameter_values, feed_item_visitor);
+	}
+
+	return;
+}
+
+void 
+gautier::rss_model::search_feed_items(const std::string& search_text, const int limit, std::vector<gautier::rss_model::unit_type_rss_search_match>& search_matches)
+{
+	std::vector<gautier::rss_model::unit_type_rss_search_match> tmp_search_matches;
+
+	const std::string 
+	match_text = make_search_match_text(search_text);
+
+	sqlite3* db_connection = nullptr;
+
+	if(!match_text.empty() && limit > 0)
+	{
+		db_lease_connection(&db_connection);
+	}
+
+	if(db_connection)
+	{
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
+
+		//rank orders by relevance. The limit is applied inside the full text index before the joins.
+		std::string 
+		sql_text = 
+		"SELECT \
+			fs.name AS feed_name, \
+			fd.id, \
+			fd.pub_date, \
+			fd.title, \
+			fd.link, \
+			fd.description, \
+			fd.pub_date_epoch \
+		FROM (SELECT rowid, rank FROM rss_feed_data_search WHERE rss_feed_data_search MATCH @match_text ORDER BY rank LIMIT @limit) AS search INNER JOIN \
+		rss_feed_data AS fd ON fd.id = search.rowid INNER JOIN \
+		rss_feed_source AS fs ON fs.id = fd.rss_feed_source_id \
+		ORDER BY \
+			 search.rank;\
+		";
+
+		std::vector<std::tuple<std::string, std::string, parameter_data_type>> 
+		parameter_values = 
+		{
+			create_binding("@match_text", match_text, parameter_data_type::text),
+			create_binding("@limit", std::to_string(limit), parameter_data_type::integer)
+		};
+
+		//Known once a connection is leased. Without FTS5 there is no index to search.
+		if(_db_connection_pool.search_available)
+		{
+			apply_sql(&db_connection, sql_text, parameter_values, [&tmp_search_matches](sqlite3_stmt* sql_stmt)
+			{
+				tmp_search_matches.emplace_back();
+
+				get_column_text(sql_stmt, 0, tmp_search_matches.back().feed_name);
+
+				make_feed_item(sql_stmt, tmp_search_matches.back().feed_item);
+			});
+		}
+	}
+
+	search_matches = std::move(tmp_search_matches);
+
+	return;
+}
+
+long long 
+gautier::rss_model::purge_feeds(const int default_retention_days, const int batch_size)
+{
+	const auto purge_start = std::chrono::steady_clock::now();
+
+	long long purged_count = 0;
+
+	sqlite3* db_connection = nullptr;
+
+	db_lease_connection(&db_connection);
+
+	if(db_connection)
+	{
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
+
+		const int rows_per_batch = std::max(1, batch_size);
+
+		//Source id and the oldest entry_date kept for it.
+		std::vector<std::pair<int, std::string>> source_cutoffs;
+
+		{
+			std::string 
+			sql_text = 
+			"SELECT \
+				id, \
+				CASE WHEN retention_days > 0 THEN retention_days ELSE @default_retention_days END AS retention_days \
+			FROM rss_feed_source;";
+
+			std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+			{
+				create_binding("@default_retention_days", std::to_string(default_retention_days), parameter_data_type::integer)
+			};
+
+			const std::time_t now = std::time(nullptr);
+
+			apply_sql(&db_connection, sql_text, parameter_values, [&source_cutoffs, now](sqlite3_stmt* sql_stmt)
+			{
+				const long long retention_days = sqlite3_column_int64(sql_stmt, 1);
+
+				if(retention_days > 0)
+				{
+					source_cutoffs.emplace_back(sqlite3_column_int(sql_stmt, 0), get_entry_date_text(now - static_cast<std::time_t>(retention_days * 86400)));
+				}
+			});
+		}
+
+		//save_feeds stages and merges rows in one transaction, so committed staging rows are already merged.
+		{
+			std::string 
+			sql_text = 
+			"DELETE FROM rss_feed_data_staging WHERE id IN (SELECT id FROM rss_feed_data_staging ORDER BY id LIMIT @batch_size);";
+
+			std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+			{
+				create_binding("@batch_size", std::to_string(rows_per_batch), parameter_data_type::integer)
+			};
+
+			purge_rows(&db_connection, sql_text, parameter_values, rows_per_batch);
+		}
+
+		//The row with the highest id is always kept, even when expired.
+		//	Ids are rowids without AUTOINCREMENT, so removing it would let the next item saved reuse an id
+		//	at or below a watermark already handed out by load_feeds_since, and that item would never be returned.
+		for(const auto& source_cutoff : source_cutoffs)
+		{
+			std::string 
+			sql_text = 
+			"DELETE FROM rss_feed_data WHERE id IN (\
+				SELECT id FROM rss_feed_data \
+				WHERE rss_feed_source_id = @id AND entry_date < @cutoff_date \
+				AND id < (SELECT MAX(id) FROM rss_feed_data) \
+				LIMIT @batch_size \
+			);";
+
+			std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+			{
+				create_binding("@id", std::to_string(source_cutoff.first), parameter_data_type::integer),
+				create_binding("@cutoff_date", source_cutoff.second, parameter_data_type::text),
+				create_binding("@batch_size", std::to_string(rows_per_batch), parameter_data_type::integer)
+			};
+
+			purged_count += purge_rows(&db_connection, sql_text, parameter_values, rows_per_batch);
+		}
+	}
+
+	record_stage_time("purge", "", std::chrono::steady_clock::now() - purge_start);
+
+	return purged_count;
+}
+
+bool 
+gautier::rss_model::parse_feed(const std::string& feed_location, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, const bool use_document_tree)
+{
+	init_feed_readers();
+
+	bool success = false;
+
+	if(use_document_tree)
+	{
+		success = collect_feed_items_from_document(feed_location, feed_items);
+	}
+	else
+	{
+		gautier::rss_model::unit_type_rss_source feed_source;
+
+		feed_source.name = feed_location;
+		feed_source.url = feed_location;
+
+		success = (collect_feed_items_from_source(feed_source, feed_items, nullptr) == fetch_collected);
+	}
+
+	return success;
+}
+
+void 
+gautier::rss_model::load_feed_transfers(std::map<std::string, gautier::rss_model::unit_type_feed_transfer>& feed_transfers)
+{
+	std::lock_guard<std::mutex> feed_transfers_guard(_feed_transfers_lock);
+
+	feed_transfers = _feed_transfers;
+
+	return;
+}
+
+void 
+gautier::rss_model::set_metrics_enabled(const bool enabled)
+{
+	_metrics_enabled = enabled;
+
+	return;
+}
+
+void 
+gautier::rss_model::load_metrics(gautier::rss_model::unit_type_rss_metrics& metrics)
+{
+	std::lock_guard<std::mutex> metrics_guard(_metrics_lock);
+
+	metrics = _metrics;
+
+	return;
+}
+
+void 
+gautier::rss_model::reset_metrics()
+{
+	std::lock_guard<std::mutex> metrics_guard(_metrics_lock);
+
+	_metrics = gautier::rss_model::unit_type_rss_metrics();
+
+	return;
+}
+
+bool 
+gautier::rss_model::output_metrics(const std::string& file_name)
+{
+	gautier::rss_model::unit_type_rss_metrics metrics;
+
+	load_metrics(metrics);
+
+	std::ofstream metrics_file(file_name);
+
+	const std::string stage_columns = 
+	"count\ttotal_us\tmax_us\t<10us\t<100us\t<1ms\t<10ms\t<100ms\t<1s\t<10s\t>=10s\n";
+
+	metrics_file << "#stage\t" << stage_columns;
+
+	for(const auto& stage : metrics.stages)
+	{
+		metrics_file << stage.first;
+
+		output_stage_metrics(metrics_file, stage.second);
+	}
+
+	metrics_file << "#feed\titems_parsed\trows_staged\trows_inserted\trows_deduplicated\tbytes_fetched\n";
+
+	for(const auto& feed : metrics.feeds)
+	{
+		metrics_file 
+		<< feed.first << "\t" 
+		<< feed.second.items_parsed << "\t" 
+		<< feed.second.rows_staged << "\t" 
+		<< feed.second.rows_inserted << "\t" 
+		<< feed.second.rows_deduplicated << "\t" 
+		<< feed.second.bytes_fetched << "\n";
+	}
+
+	metrics_file << "#feed\tstage\t" << stage_columns;
+
+	for(const auto& feed : metrics.feeds)
+	{
+		for(const auto& stage : feed.second.stages)
+		{
+			metrics_file << feed.first << "\t" << stage.first;
+
+			output_stage_metrics(metrics_file, stage.second);
+		}
+	}
+
+	metrics_file.close();
+
+	return !metrics_file.fail();
+}
+
+void 
+gautier::rss_model::create_feed_items_list(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items, std::vector<unit_type_rss_item>& rss_items)
+{
+	for(const auto& named_list : rss_feed_items)
+	{
+		std::vector<gautier::rss_model::unit_type_rss_item> feed_list = named_list.second;
+
+		for(gautier::rss_model::unit_type_rss_item& feed_item : feed_list)
+		{
+			unit_type_rss_item rss_item;
+
+			rss_items.push_back(rss_item);
+		}
+
+		break;
+	}
+
+	return;
+}
+
+void 
+gautier::rss_model::set_storage_settings(const gautier::rss_model::unit_type_storage_settings& storage_settings)
+{
+	std::lock_guard<std::mutex> pool_guard(_db_connection_pool.lock);
+
+	if(storage_settings.database_file_name != _db_connection_pool.storage_settings.database_file_name)
+	{
+		_db_connection_pool.tables_exist = false;
+	}
+
+	_db_connection_pool.storage_settings = storage_settings;
+
+	return;
+}
+
+void 
+gautier::rss_model::close_feeds_storage()
+{
+	db_close_idle_connections();
+
+	return;
+}
+
+//Presents rss feed information to standard output.
+//An optional, convenience function primarily for diagnostic/testing purposes 
+//	but whose sequence can be adapted to other file based output processes.
+//One of those processes can involve converting the rss feed information into 
+//	HTML file format.
+//HTML output is not designed into this version, but would be a quick way 
+//	to put feeds into a format that can be immediately used in a web browser.
+void 
+gautier::rss_model::output_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+{
+	const std::string heading_line = "***********************************************";
+
+	std::stringstream ostr;
+
+	//each feed.
+	for(const auto& named_list : rss_feed_items)
+	{
+		const std::string& list_name = named_list.first;
+
+		ostr << heading_line << "\n";
+		ostr << "\t\t" << list_name << "\n";
+		ostr << heading_line << "\n";
+
+		std::vector<gautier::rss_model::unit_type_rss_item> feed_list = named_list.second;
+
+		//Each value is an anonymous item that is a list of name/value pairs
+		for(gautier::rss_model::unit_type_rss_item& feed_item : feed_list)
 		{
 			ostr << "------ details ----------------\n";
 
@@ -527,13 +1392,14 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 
 	sqlite3* db_connection = nullptr;
 
-	db_check_database_exist(&db_connection);
+	db_lease_connection(&db_connection);
 
 	if(db_connection)
 	{
-		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_finalize);
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
 
-		bool tables_exist = db_check_tables_exist(&db_connection);
+		//Confirmed once, when the first connection was opened.
+		bool tables_exist = _db_connection_pool.tables_exist;
 
 		if(tables_exist)
 		{
@@ -543,14 +1409,15 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 
 				std::string 
 				sql_text = 
-				"INSERT INTO rss_feed_source(name, url) VALUES (trim(@name), trim(@url));";
+				"INSERT INTO rss_feed_source(name, url, retention_days) VALUES (trim(@name), trim(@url), @retention_days);";
 
 				for(const auto& feed_source : feed_sources)
 				{
 					std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
 					{
 						create_binding("@name", feed_source.second.name, parameter_data_type::text),
-						create_binding("@url", feed_source.second.url, parameter_data_type::text)
+						create_binding("@url", feed_source.second.url, parameter_data_type::text),
+						create_binding("@retention_days", std::to_string(feed_source.second.retention_days), parameter_data_type::integer)
 					};
 
 					apply_sql(&db_connection, sql_text, parameter_values, nullptr);
@@ -561,11 +1428,22 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 
 			//COLLECT RSS FEED NAME CHANGES.
 			{
-				char* error_message = 0;
-				auto sql_query_exec_result = SQLITE_BUSY;
+				struct feed_source_name_change
+				{
+					int 
+						dest_id,
+						src_id,
+						src_retention_days
+					;
+
+					std::string 
+						src_name
+					;
+				};
 
-				std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values;
-				query_values.reset(new std::vector<std::map<std::string, std::string>>);
+				std::vector<feed_source_name_change> name_changes;
+
+				auto sql_query_exec_result = false;
 
 				{
 					std::string 
@@ -574,36 +1452,50 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 						 dest.id AS dest_id, \
 						 dest.name AS dest_name, \
 						 src.id AS src_id, \
-						 src.name AS src_name \
+						 src.name AS src_name, \
+						 src.retention_days AS src_retention_days \
 					FROM (SELECT id, name, url FROM rss_feed_source WHERE type_code = 0) AS dest INNER JOIN \
-					(SELECT id, name, url FROM rss_feed_source WHERE type_code = 1) AS src ON dest.url = src.url \
+					(SELECT id, name, url, retention_days FROM rss_feed_source WHERE type_code = 1) AS src ON dest.url = src.url \
 					COLLATE NOCASE; \
 					";
 
 					sql_query_exec_result = 
-					sqlite3_exec(db_connection, sql_text.data(), translate_sql_result, query_values.get(), &error_message);
+					apply_sql(&db_connection, sql_text, _empty_param_set, [&name_changes](sqlite3_stmt* sql_stmt)
+					{
+						feed_source_name_change name_change;
+
+						name_change.dest_id = sqlite3_column_int(sql_stmt, 0);
+						name_change.src_id = sqlite3_column_int(sql_stmt, 2);
+						name_change.src_retention_days = sqlite3_column_int(sql_stmt, 4);
+
+						get_column_text(sql_stmt, 3, name_change.src_name);
+
+						name_changes.push_back(std::move(name_change));
+					}).first;
 				}
 
 				//RECONCILE OLD NAMES WITH NEW.
-				if(sql_query_exec_result == SQLITE_OK)
+				if(sql_query_exec_result)
 				{
-					if(query_values)
+					if(!name_changes.empty())
 					{
 						db_transact_begin(&db_connection);
 
 						//APPLY NEW NAMES TO OLD.
-						for(const auto& row_of_data : *query_values)
+						for(const auto& name_change : name_changes)
 						{
 							//If the input names changed,
 							//but the url stayed the same, update the names to match.
+							//The retention in the input is taken as well.
 							std::string 
 							sql_text = 
-							"UPDATE rss_feed_source SET name = @name WHERE id = @id;";
+							"UPDATE rss_feed_source SET name = @name, retention_days = @retention_days WHERE id = @id;";
 
 							std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
 							{
-								create_binding("@name", get_first_db_column_value(row_of_data, "src_name"), parameter_data_type::text),
-								create_binding("@id", get_first_db_column_value(row_of_data, "dest_id"), parameter_data_type::integer)
+								create_binding("@name", name_change.src_name, parameter_data_type::text),
+								create_binding("@retention_days", std::to_string(name_change.src_retention_days), parameter_data_type::integer),
+								create_binding("@id", std::to_string(name_change.dest_id), parameter_data_type::integer)
 							};
 
 							apply_sql(&db_connection, sql_text, parameter_values, nullptr);
@@ -612,7 +1504,7 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 						//REMOVE DUPLICATE RSS FEED SOURCES.
 						//Once the names are synched, 
 						//remove the source update data.
-						for(const auto& row_of_data : *query_values)
+						for(const auto& name_change : name_changes)
 						{
 							std::string 
 							sql_text = 
@@ -620,7 +1512,7 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 
 							std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
 							{
-								create_binding("@id", get_first_db_column_value(row_of_data, "src_id"), parameter_data_type::integer)
+								create_binding("@id", std::to_string(name_change.src_id), parameter_data_type::integer)
 							};
 
 							apply_sql(&db_connection, sql_text, parameter_values, nullptr);
@@ -629,10 +1521,6 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 						db_transact_end(&db_connection);
 					}
 				}
-				else
-				{
-					output_op_sql_error_message(&error_message, __LINE__);
-				}
 			}
 
 			//ACCEPT REMAINING RSS FEED SOURCES.
@@ -658,14 +1546,11 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 			//	limiting how often those networks can be queried for RSS information 
 			//	from a given computer.
 			//The query below is written under the default view that this policy is in effect.
-			//A minimum time frame of 1 hour has been chosen as the length of the window 
-			//	before a query can once again be issued for a network source of RSS data.
-
-			//This time window could be parameterized to allow an extension of the window.
-			//	The ability to vary the time window is not encoded in this version 
-			//	since that is was not a desired capability. It can be trivially 
-			//	introduced, but if it is, it is recommended that a small validation check 
-			//	be introduced to enforce the suggested minimum time window of 1 hour.
+			//Each feed source has its own window, kept in next_due by schedule_feeds.
+			//	The window follows how often the feed publishes, learned from the 
+			//	publication dates of its saved items, and is never shorter than 
+			//	_refresh_min_seconds nor the ttl the feed asks for.
+			//	Hours and days listed in the skipHours and skipDays of the feed are avoided.
 
 			//The query uses the type_code field to represent the status of the data.
 			//A type_code of 0 means the rss feed is unchanged in status from the last time 
@@ -688,16 +1573,15 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 			//	would be the logical choice to provide this level of communication.
 
 			//Based on the above description, the SQL is defined as follows:
-			//	An SQL CASE statement evaluates the entry date field.
-			//	The first case branch deals with rows imported for the first time.
+			//	An SQL CASE statement evaluates the next_due field.
 			//Scenario #1
-			//	Those first-time rows are set to indicate that RSS feed data should be 
-			//	gathered during the next pass query for RSS feed data from networks.
+			//	Rows imported for the first time have a next_due of 0 and are set to indicate 
+			//	that RSS feed data should be gathered during the next pass.
 			//Scenario #2
-			//	The second case branch is the time window spoken about earlier and is 
-			//	what determines when RSS feed data is actually refreshed.
+			//	Rows whose next_due has passed are what determines when RSS feed data is 
+			//	actually refreshed.
 			//Scenario #3
-			//	The third branch of the CASE statement returns the type_code as is which 
+			//	Otherwise the CASE statement returns the type_code as is which 
 			//	should normally indicate no action is required for a given RSS feed source.
 
 			//The overall program's activity regarding RSS data collection and organization 
@@ -710,48 +1594,44 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 			 \
 				id,\
 				CASE \
-					WHEN (datetime(entry_date, '+1 minute')) > (datetime('now', 'localtime')) \
-					THEN 3 \
-					WHEN (datetime(entry_date, '+1 hour')) < (datetime('now', 'localtime')) \
+					WHEN next_due <= CAST(strftime('%s', 'now') AS INTEGER) \
 					THEN 3 \
 					ELSE type_code \
 				END AS type_code,\
 				entry_date,\
 				name,\
-				url\
+				url,\
+				etag,\
+				last_modified,\
+				next_due,\
+				ttl_minutes,\
+				skip_hours,\
+				skip_days,\
+				retention_days\
 			 FROM rss_feed_source;\
 			";
 
-			std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values;
-			query_values.reset(new std::vector<std::map<std::string, std::string>>);
-
-			char* error_message = 0;
+			apply_sql(&db_connection, sql_text, _empty_param_set, [&final_feed_sources](sqlite3_stmt* sql_stmt)
+			{
+				gautier::rss_model::unit_type_rss_source 
+				rss_source;
 
-			const auto sql_query_exec_result = 
-			sqlite3_exec(db_connection, sql_text.data(), translate_sql_result, query_values.get(), &error_message);
+				rss_source.id = sqlite3_column_int(sql_stmt, 0);
+				rss_source.type_code = sqlite3_column_int(sql_stmt, 1);
 
-			if(sql_query_exec_result == SQLITE_OK)
-			{
-				if(query_values && !query_values->empty())
-				{
-					for(auto& row_of_data : *query_values)
-					{
-						gautier::rss_model::unit_type_rss_source 
-						rss_source;
+				get_column_text(sql_stmt, 3, rss_source.name);
+				get_column_text(sql_stmt, 4, rss_source.url);
+				get_column_text(sql_stmt, 5, rss_source.etag);
+				get_column_text(sql_stmt, 6, rss_source.last_modified);
 
-						rss_source.id = std::stoi(row_of_data["id"]);
-						rss_source.type_code = std::stoi(row_of_data["type_code"]);
-						rss_source.name = row_of_data["name"];
-						rss_source.url = row_of_data["url"];
+				rss_source.next_due = sqlite3_column_int64(sql_stmt, 7);
+				rss_source.ttl_minutes = sqlite3_column_int(sql_stmt, 8);
+				rss_source.skip_hours = sqlite3_column_int(sql_stmt, 9);
+				rss_source.skip_days = sqlite3_column_int(sql_stmt, 10);
+				rss_source.retention_days = sqlite3_column_int(sql_stmt, 11);
 
-						final_feed_sources[rss_source.name] = rss_source;
-					}
-				}
-			}
-			else
-			{
-				output_op_sql_error_message(&error_message, __LINE__);
-			}
+				final_feed_sources[rss_source.name] = std::move(rss_source);
+			});
 
 		}//end of table scope
 	}
@@ -762,29 +1642,46 @@ filter_feeds_source(const std::map<std::string, gautier::rss_model::unit_type_rs
 //THE TRUE TRIGGER FOR RSS DOWNLOAD.
 //The idea is to update the main entry date whenever a feed is accessed over the network.
 static void 
-save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items, const std::map<std::string, gautier::rss_model::unit_type_rss_source>& collected_sources)
 {
 	sqlite3* db_connection = nullptr;
 
 	if(!rss_feed_items.empty())
 	{
-		db_check_database_exist(&db_connection);
+		db_lease_connection(&db_connection);
 	}
 
 	if(db_connection)
 	{
-		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_finalize);
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
 
 		enable_op_sql_trace(&db_connection);
 
 		db_transact_begin(&db_connection);
 
+		//Staging rows added by this call have ids above this value.
+		//The merge below only reads those rows rather than all of staging.
+		sqlite3_int64 staging_watermark = 0;
+		{
+			std::string 
+			sql_text = 
+			"SELECT COALESCE(MAX(id), 0) FROM rss_feed_data_staging;";
+
+			apply_sql(&db_connection, sql_text, _empty_param_set, [&staging_watermark](sqlite3_stmt* sql_stmt)
+			{
+				staging_watermark = sqlite3_column_int64(sql_stmt, 0);
+			});
+		}
+
+		//Names of the feeds staged, by source id, to report the rows each one added.
+		std::map<int, std::string> staged_feed_names;
+
 		for(const auto& rss_feed_item : rss_feed_items)
 		{
 			int rss_feed_source_id = 0;
 
 			const std::string rss_feed_name = rss_feed_item.first;
-			std::vector<gautier::rss_model::unit_type_rss_item> feed_items = rss_feed_item.second;
+			const std::vector<gautier::rss_model::unit_type_rss_item>& feed_items = rss_feed_item.second;
 
 			//GET RSS FEED DESCRIPTION RECORD.
 			{
@@ -801,28 +1698,15 @@ save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type
 					create_binding("@name", rss_feed_name, parameter_data_type::text)
 				};
 
-				std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values;
-				query_values.reset(new std::vector<std::map<std::string, std::string>>);
-
-				apply_sql(&db_connection, sql_text, parameter_values, query_values);
-
-				if(query_values)
+				apply_sql(&db_connection, sql_text, parameter_values, [&rss_feed_source_id](sqlite3_stmt* sql_stmt)
 				{
-					for(auto& row_of_data : *query_values)
+					if(rss_feed_source_id == 0)
 					{
-						std::string id_text_value = 
-						row_of_data["id"];
-
-						if(!id_text_value.empty())
-						{
-							rss_feed_source_id = std::stoi(id_text_value);
-						}
-
-						break;
+						rss_feed_source_id = sqlite3_column_int(sql_stmt, 0);
 					}
-				}
+				});
 
-				//ABORTS THE ENTIRE OPERATION for this feed.
+				//SKIPS THIS FEED. The other feeds are still saved.
 				//Without a source_id, there is no linkage that can be made.
 				if(rss_feed_source_id == 0)
 				{
@@ -832,61 +1716,65 @@ save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type
 					<< __func__ 
 					<< "\n";
 
-					break;
+					continue;
 				}
 			}
 
-			for(auto& feed_item : feed_items)
-			{
-				//IMPORT RSS FEED DATA.
-				{
-					std::string 
-					sql_text = 
-					"INSERT INTO rss_feed_data_staging \
-					(\
-						rss_feed_source_id,\
-						pub_date,\
-						title,\
-						link,\
-						description\
-					)\
-					VALUES \
-					(\
-						@rss_feed_source_id,\
-						@pub_date,\
-						trim(@title),\
-						trim(@link),\
-						trim(@description)\
-					)\
-					;";
+			staged_feed_names[rss_feed_source_id] = rss_feed_name;
 
-					std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
-					{
-						create_binding("@rss_feed_source_id", std::to_string(rss_feed_source_id), parameter_data_type::integer),
-						create_binding("@pub_date", feed_item.pubdate, parameter_data_type::text),
-						create_binding("@title", feed_item.title, parameter_data_type::text),
-						create_binding("@link", feed_item.link, parameter_data_type::text),
-						create_binding("@description", feed_item.description, parameter_data_type::text)
-					};
+			const auto staging_start = std::chrono::steady_clock::now();
 
-					apply_sql(&db_connection, sql_text, parameter_values, nullptr);
-				}
+			//IMPORT RSS FEED DATA.
+			stage_feed_items(&db_connection, rss_feed_source_id, feed_items);
+
+			if(_metrics_enabled)
+			{
+				gautier::rss_model::unit_type_feed_metrics feed_counts;
+
+				feed_counts.rows_staged = static_cast<long long>(feed_items.size());
+
+				record_feed_counts(rss_feed_name, feed_counts);
+				record_stage_time("staging_insert", rss_feed_name, std::chrono::steady_clock::now() - staging_start);
 			}
 		}
 
-		db_transact_end(&db_connection);
-
 		//Transfers eligible feeds data entries from staging to active.
-		//The staging data remains in place for diagnostic purposes.
-		//Older entries will be purged from both tables.
+		//Done in the transaction that staged them, so a purge_feeds in another process or a crash
+		//	can never leave staged rows unmerged while the new cache validators are kept.
+		//The staging data remains in place for diagnostic purposes until purge_feeds removes it.
+		//Only the rows staged by this call are read. Links already present are skipped
+		//	through the unique link index, so the cost follows the new rows, not the table size.
 		{
-			db_transact_begin(&db_connection);
+			//Rows the merge adds to rss_feed_data have ids above this value. Only read for metrics.
+			sqlite3_int64 data_watermark = 0;
+
+			const bool metrics_enabled = _metrics_enabled;
+
+			if(metrics_enabled)
+			{
+				std::string 
+				sql_text = 
+				"SELECT COALESCE(MAX(id), 0) FROM rss_feed_data;";
+
+				apply_sql(&db_connection, sql_text, _empty_param_set, [&data_watermark](sqlite3_stmt* sql_stmt)
+				{
+					data_watermark = sqlite3_column_int64(sql_stmt, 0);
+				});
+			}
+
+			const auto merge_start = std::chrono::steady_clock::now();
+
+			std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+			{
+				create_binding("@staging_watermark", std::to_string(staging_watermark), parameter_data_type::integer)
+			};
 
 			std::string 
 			sql_text = 
 			"INSERT INTO rss_feed_data ( \
 				 rss_feed_source_id, \
 				 pub_date, \
+				 pub_date_epoch, \
 				 title, \
 				 link, \
 				 description \
@@ -894,35 +1782,70 @@ save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type
 			SELECT \
 				 rss_feed_source_id, \
 				 pub_date, \
+				 pub_date_epoch, \
 				 title, \
 				 link, \
 				 description \
 			FROM rss_feed_data_staging \
-			WHERE link NOT IN ( \
-				SELECT \
-					 link \
-				FROM rss_feed_data \
-				GROUP BY link \
-			) GROUP BY \
-				 rss_feed_source_id, \
-				 pub_date, \
-				 title, \
-				 link, \
-				 description \
+			WHERE id > @staging_watermark \
 			ORDER BY \
 				 rss_feed_source_id, \
-				 pub_date DESC, \
+				 pub_date_epoch DESC, \
 				 title \
+			ON CONFLICT (link) DO NOTHING \
 			; \
-			DELETE \
-			FROM rss_feed_data_staging \
-			WHERE (datetime(entry_date, '+8 hour')) < (datetime('now', 'localtime'));\
-			DELETE \
-			FROM rss_feed_data \
-			WHERE (datetime(entry_date, '+1 month')) < (datetime('now', 'localtime'));\
 			";
 
-			apply_sql(&db_connection, sql_text, _empty_param_set, nullptr);
+			apply_sql(&db_connection, sql_text, parameter_values, nullptr);
+
+			if(metrics_enabled)
+			{
+				record_stage_time("merge", "", std::chrono::steady_clock::now() - merge_start);
+
+				std::string 
+				sql_text = 
+				"SELECT rss_feed_source_id, COUNT(*) FROM rss_feed_data WHERE id > @data_watermark GROUP BY rss_feed_source_id;";
+
+				std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+				{
+					create_binding("@data_watermark", std::to_string(data_watermark), parameter_data_type::integer)
+				};
+
+				std::map<int, long long> inserted_row_counts;
+
+				apply_sql(&db_connection, sql_text, parameter_values, [&inserted_row_counts](sqlite3_stmt* sql_stmt)
+				{
+					inserted_row_counts[sqlite3_column_int(sql_stmt, 0)] = sqlite3_column_int64(sql_stmt, 1);
+				});
+
+				for(const auto& staged_feed_name : staged_feed_names)
+				{
+					gautier::rss_model::unit_type_feed_metrics feed_counts;
+
+					feed_counts.rows_inserted = inserted_row_counts[staged_feed_name.first];
+					feed_counts.rows_deduplicated = static_cast<long long>(rss_feed_items.at(staged_feed_name.second).size()) - feed_counts.rows_inserted;
+
+					record_feed_counts(staged_feed_name.second, feed_counts);
+				}
+			}
+
+			//KEEP HTTP CACHE VALIDATORS.
+			//Saved with the items so a feed is never reported unchanged before its items are stored.
+			for(const auto& collected_source : collected_sources)
+			{
+				std::string 
+				sql_text = 
+				"UPDATE rss_feed_source SET etag = @etag, last_modified = @last_modified WHERE name = @name;";
+
+				std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+				{
+					create_binding("@etag", collected_source.second.etag, parameter_data_type::text),
+					create_binding("@last_modified", collected_source.second.last_modified, parameter_data_type::text),
+					create_binding("@name", collected_source.first, parameter_data_type::text)
+				};
+
+				apply_sql(&db_connection, sql_text, parameter_values, nullptr);
+			}
 
 			db_transact_end(&db_connection);
 		}
@@ -931,796 +1854,3214 @@ save_feeds(const std::map<std::string, std::vector<gautier::rss_model::unit_type
 	return;
 }
 
-static void 
-make_feed_item(std::map<std::string, std::string>& row_of_data, gautier::rss_model::unit_type_rss_item& feed_item)
+//Builds the statement that inserts row_count feed items into rss_feed_data_staging.
+//Parameters 1 and 2, the source id and entry date, are shared by every row.
+//	Each row then takes five more: pub_date, pub_date_epoch, title, link and description.
+static std::string 
+make_staging_insert_text(const int row_count)
+{
+	std::string 
+	sql_text = 
+	"INSERT INTO rss_feed_data_staging \
+	(\
+		rss_feed_source_id,\
+		entry_date,\
+		pub_date,\
+		pub_date_epoch,\
+		title,\
+		link,\
+		description\
+	)\
+	VALUES ";
+
+	for(int row_n = 0; row_n < row_count; row_n++)
+	{
+		const int param_n = 3 + row_n * 5;
+
+		sql_text += (row_n == 0) ? "" : ",";
+		sql_text += "(?1, ?2, ?" + std::to_string(param_n) 
+		+ ", ?" + std::to_string(param_n + 1) 
+		+ ", trim(?" + std::to_string(param_n + 2) 
+		+ "), trim(?" + std::to_string(param_n + 3) 
+		+ "), trim(?" + std::to_string(param_n + 4) + "))";
+	}
+
+	sql_text += ";";
+
+	return sql_text;
+}
+
+//entry_date of feed items saved at entry_time.
+//Same text as datetime(CURRENT_TIMESTAMP, 'localtime'), so it orders the same as the column default.
+static std::string 
+get_entry_date_text(const std::time_t entry_time)
 {
-	feed_item.title = row_of_data["title"];
-	feed_item.link = row_of_data["link"];
-	feed_item.description = row_of_data["description"];
-	feed_item.pubdate = row_of_data["pub_date"];
+	std::tm entry_time_parts{};
 
-	return;
+	localtime_r(&entry_time, &entry_time_parts);
+
+	char entry_date[32] = {0};
+
+	std::strftime(entry_date, sizeof(entry_date), "%Y-%m-%d %H:%M:%S", &entry_time_parts);
+
+	return entry_date;
 }
 
-//Retrieves rss data at a given url, decodes the XML into a data structure named, std::map<std::string, std::vector<std::map<std::string, std::string>>>.
-//Retrieval logic is done by the xml library which will pull from a file location or web address.
-//After retrieval, xml represented as various libxml objects.
-//The linked list is traversed in a compact sequenct that converts entries in a std::map<std::string, std::vector<std::map<std::string, std::string>>> data structure.
+//Writes the items of one feed to rss_feed_data_staging, _staging_batch_size rows per statement.
+//The items left over are written by statements of half, a quarter and so on of that size, largest first.
+//	A feed of 50 items takes three statements, of 32, 16 and 2 rows, rather than 50 single row statements.
+//Every statement stays in the statement cache, and the item text is bound in place without copying.
+//The entry date is worked out once rather than by the column default on every row.
+//The publication date of each item is read into seconds since the epoch as it is written.
 static void 
-collect_feed_items_from_rss(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items)
+stage_feed_items(sqlite3** db_connection, const int rss_feed_source_id, const std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)
 {
-	for(auto& feed_source : feed_sources)
+	//Entry n inserts _staging_batch_size >> n rows. The last inserts one.
+	static const std::vector<std::string> 
+	batch_sql_texts = []
 	{
-		if(feed_source.second.type_code == 3)//collect from feeds past expire date.
+		std::vector<std::string> sql_texts;
+
+		for(int row_count = _staging_batch_size; row_count > 0; row_count /= 2)
 		{
-			//see libxml2 tree1.c example file for the general structure used.
-			LIBXML_TEST_VERSION
+			sql_texts.push_back(make_staging_insert_text(row_count));
+		}
 
-			auto xml_parse_options = (XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING | XML_PARSE_NOBLANKS | XML_PARSE_NOCDATA);
+		return sql_texts;
+	}();
 
-			xmlDoc *doc = 
-			xmlReadFile(feed_source.second.url.data(), nullptr, xml_parse_options);
+	const std::string 
+	entry_date = get_entry_date_text(std::time(nullptr));
 
-			if(doc)
-			{
-				xmlNode *root_element = 
-				xmlDocGetRootElement(doc);
+	std::vector<sqlite3_stmt*> 
+	batch_sql_stmts(batch_sql_texts.size(), nullptr);
 
-				if(root_element)
-				{
-					std::vector<gautier::rss_model::unit_type_rss_item> rss_feed_values;
+	type_list_size item_n = 0;
 
-					rss_feed_values.reserve(_list_reserve_size);
+	while(item_n < feed_items.size())
+	{
+		const type_list_size remaining_count = feed_items.size() - item_n;
 
-					rss_feed_items[feed_source.first] = rss_feed_values;
+		type_list_size batch_n = 0;
 
-					collect_feed_items(root_element, rss_feed_items[feed_source.first]);
-				}
+		while(static_cast<type_list_size>(_staging_batch_size >> batch_n) > remaining_count)
+		{
+			batch_n++;
+		}
+
+		sqlite3_stmt*& sql_stmt = batch_sql_stmts[batch_n];
+
+		if(!sql_stmt)
+		{
+			sql_stmt = db_get_statement(db_connection, batch_sql_texts[batch_n]);
 
-				xmlFreeDoc(doc);
-				xmlCleanupParser();
+			if(sql_stmt)
+			{
+				sqlite3_bind_int(sql_stmt, 1, rss_feed_source_id);
+				sqlite3_bind_text(sql_stmt, 2, entry_date.data(), static_cast<int>(entry_date.size()), SQLITE_TRANSIENT);
 			}
 		}
+
+		if(!sql_stmt)
+		{
+			break;
+		}
+
+		const int row_count = _staging_batch_size >> batch_n;
+
+		for(int row_n = 0; row_n < row_count; row_n++, item_n++)
+		{
+			const gautier::rss_model::unit_type_rss_item& feed_item = feed_items[item_n];
+
+			const int param_n = 3 + row_n * 5;
+
+			long long pub_date_epoch = 0;
+
+			parse_feed_date(feed_item.pubdate, pub_date_epoch);
+
+			sqlite3_bind_text(sql_stmt, param_n, feed_item.pubdate.data(), static_cast<int>(feed_item.pubdate.size()), SQLITE_STATIC);
+			sqlite3_bind_int64(sql_stmt, param_n + 1, pub_date_epoch);
+			sqlite3_bind_text(sql_stmt, param_n + 2, feed_item.title.data(), static_cast<int>(feed_item.title.size()), SQLITE_STATIC);
+			sqlite3_bind_text(sql_stmt, param_n + 3, feed_item.link.data(), static_cast<int>(feed_item.link.size()), SQLITE_STATIC);
+			sqlite3_bind_text(sql_stmt, param_n + 4, feed_item.description.data(), static_cast<int>(feed_item.description.size()), SQLITE_STATIC);
+		}
+
+		if(sqlite3_step(sql_stmt) != SQLITE_DONE)
+		{
+			output_op_sql_error_message(db_connection, __LINE__);
+		}
+
+		//Bindings are kept for the next batch of the same size, which binds over every item parameter.
+		sqlite3_reset(sql_stmt);
+	}
+
+	//The bound text belongs to feed_items. Cleared so the cached statements do not keep pointers to it.
+	for(sqlite3_stmt* sql_stmt : batch_sql_stmts)
+	{
+		if(sql_stmt)
+		{
+			sqlite3_clear_bindings(sql_stmt);
+		}
 	}
 
 	return;
 }
 
-//See libxml2 tree1.c example file for the general structure used. 9/24/2015
+//Sets when each feed source that was just read is downloaded again.
+//The interval is learned from the publication dates of the most recent items saved for the feed.
+//A feed that could not be read is tried again after a short wait, keeping its saved schedule hints.
 static void 
-collect_feed_items(xmlNode* xml_element, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)
+schedule_feeds(const std::vector<gautier::rss_model::unit_type_rss_source>& fetched_sources, const std::vector<feed_fetch_status>& fetch_statuses)
 {
-	for(xmlNode* current_node = xml_element; (current_node != nullptr); current_node = current_node->next)
+	sqlite3* db_connection = nullptr;
+
+	if(!fetched_sources.empty())
 	{
-		if(current_node->type == XML_ELEMENT_NODE)
+		db_lease_connection(&db_connection);
+	}
+
+	if(db_connection)
+	{
+		std::shared_ptr<sqlite3> db_connection_guard(db_connection, db_connection_guard_release);
+
+		const long long now = static_cast<long long>(std::time(nullptr));
+
+		db_transact_begin(&db_connection);
+
+		for(type_list_size source_n = 0; source_n < fetched_sources.size() && source_n < fetch_statuses.size(); source_n++)
 		{
-			const std::string current_local_name = 
-			get_string_from_xmlchar(current_node->name, switch_letter_case);
+			const gautier::rss_model::unit_type_rss_source& feed_source = 
+			fetched_sources[source_n];
 
-			if(current_local_name == _element_name_item)
+			if(fetch_statuses[source_n] == fetch_stopped)
 			{
-				feed_items.push_back(gautier::rss_model::unit_type_rss_item());
+				continue;
+			}
+
+			if(fetch_statuses[source_n] == fetch_failed)
+			{
+				std::string 
+				sql_text = 
+				"UPDATE rss_feed_source SET next_due = @next_due WHERE id = @id;";
+
+				std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+				{
+					create_binding("@next_due", std::to_string(now + _refresh_retry_seconds), parameter_data_type::integer),
+					create_binding("@id", std::to_string(feed_source.id), parameter_data_type::integer)
+				};
+
+				apply_sql(&db_connection, sql_text, parameter_values, nullptr);
+
+				continue;
 			}
-			else if(is_an_approved_rss_data_name(current_local_name))
+
+			std::vector<long long> pub_times;
+
 			{
-				const std::string parent_local_name = 
-				get_string_from_xmlchar(current_node->parent->name, nullptr);
+				//Items whose date could not be read are left out.
+				//Ordered by date, not id. The merge inserts a batch newest first, so the highest ids are its oldest items.
+				//	Read from the (rss_feed_source_id, pub_date_epoch) index without sorting.
+				std::string 
+				sql_text = 
+				"SELECT pub_date_epoch FROM rss_feed_data WHERE rss_feed_source_id = @id AND pub_date_epoch <> 0 ORDER BY pub_date_epoch DESC LIMIT @history_size;";
 
-				if(parent_local_name == _element_name_item && !feed_items.empty())
+				std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
 				{
-					gautier::rss_model::unit_type_rss_item& feed_item = 
-					feed_items.back();
+					create_binding("@id", std::to_string(feed_source.id), parameter_data_type::integer),
+					create_binding("@history_size", std::to_string(_refresh_history_size), parameter_data_type::integer)
+				};
 
-					std::string node_data;
-					{
-						xmlChar* node_value = 
-						xmlNodeGetContent(current_node);
+				apply_sql(&db_connection, sql_text, parameter_values, [&pub_times](sqlite3_stmt* sql_stmt)
+				{
+					pub_times.push_back(sqlite3_column_int64(sql_stmt, 0));
+				});
+			}
 
-						node_data = get_string_from_xmlchar(node_value, nullptr);
+			{
+				std::string 
+				sql_text = 
+				"UPDATE rss_feed_source SET \
+					 next_due = @next_due, \
+					 ttl_minutes = @ttl_minutes, \
+					 skip_hours = @skip_hours, \
+					 skip_days = @skip_days \
+				WHERE id = @id;";
 
-						xmlFree(node_value);
-					}
+				std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+				{
+					create_binding("@next_due", std::to_string(get_refresh_due_time(feed_source, std::move(pub_times), now)), parameter_data_type::integer),
+					create_binding("@ttl_minutes", std::to_string(feed_source.ttl_minutes), parameter_data_type::integer),
+					create_binding("@skip_hours", std::to_string(feed_source.skip_hours), parameter_data_type::integer),
+					create_binding("@skip_days", std::to_string(feed_source.skip_days), parameter_data_type::integer),
+					create_binding("@id", std::to_string(feed_source.id), parameter_data_type::integer)
+				};
 
-					if(current_local_name == "title")
-					{
-						feed_item.title = node_data;
-					}
-					else if(current_local_name == "link")
-					{
-						feed_item.link = node_data;
-					}
-					else if(current_local_name == "description")
-					{
-						feed_item.description = node_data;
-					}
-					else if(current_local_name == "pub_date")
-					{
-						feed_item.pubdate = node_data;
-					}
-				}
+				apply_sql(&db_connection, sql_text, parameter_values, nullptr);
 			}
 		}
 
-		collect_feed_items(current_node->children, feed_items);
+		db_transact_end(&db_connection);
 	}
 
 	return;
 }
 
-static std::string 
-get_string_from_xmlchar(const xmlChar* xstring_in, decltype(switch_letter_case) transform_func)
+//A feed is expected to publish again after the median gap between its recent publication dates.
+//The interval is kept within the refresh bounds, then lengthened to the ttl of the feed.
+//Hours and days the feed asks to be skipped are stepped over an hour at a time.
+static long long 
+get_refresh_due_time(const gautier::rss_model::unit_type_rss_source& feed_source, std::vector<long long> pub_times, const long long now)
 {
-	std::string value;
+	std::sort(pub_times.begin(), pub_times.end());
+
+	pub_times.erase(std::unique(pub_times.begin(), pub_times.end()), pub_times.end());
 
-	if(xstring_in)
+	long long interval = _refresh_default_seconds;
+
+	if(pub_times.size() > 1)
 	{
-		std::stringstream ostr;
-	
-		ostr << xstring_in;
+		std::vector<long long> pub_gaps;
+
+		for(type_list_size time_n = 1; time_n < pub_times.size(); time_n++)
+		{
+			pub_gaps.push_back(pub_times[time_n] - pub_times[time_n - 1]);
+		}
 
-		value = ostr.str();
+		std::nth_element(pub_gaps.begin(), pub_gaps.begin() + pub_gaps.size() / 2, pub_gaps.end());
+
+		interval = pub_gaps[pub_gaps.size() / 2];
 	}
 
-	if(transform_func && !value.empty())
+	interval = std::min(std::max(interval, _refresh_min_seconds), _refresh_max_seconds);
+	interval = std::max(interval, static_cast<long long>(feed_source.ttl_minutes) * 60);
+
+	long long due_time = now + interval;
+
+	//At most one week of hours, in case every hour or day is skipped.
+	for(int hour_n = 0; hour_n < 24 * 7 && (feed_source.skip_hours || feed_source.skip_days); hour_n++)
 	{
-		std::transform(value.begin(), value.end(), value.begin(), transform_func);
+		const std::time_t due_time_value = static_cast<std::time_t>(due_time);
+
+		std::tm due_time_parts{};
+
+		gmtime_r(&due_time_value, &due_time_parts);
+
+		const bool skipped = 
+		((feed_source.skip_hours >> due_time_parts.tm_hour) & 1) || ((feed_source.skip_days >> due_time_parts.tm_wday) & 1);
+
+		if(!skipped)
+		{
+			break;
+		}
+
+		//Start of the next hour.
+		due_time = (due_time / 3600 + 1) * 3600;
 	}
 
-	return value;
+	return due_time;
 }
 
-//Defines interest in specific element names from the input XML data.
-//This confirms that an element name exists in the list of approved
-//	element names. Other code uses this to determine if data 
-//	from an element should be retrieved.
-static bool 
-is_an_approved_rss_data_name(const std::string& element_name)
+//Reads a feed item from a result row laid out as 
+//	feed name, id, pub_date, title, link, description, pub_date_epoch.
+static void 
+make_feed_item(sqlite3_stmt* sql_stmt, gautier::rss_model::unit_type_rss_item& feed_item)
 {
-	bool match_found = false;
+	feed_item.id = sqlite3_column_int(sql_stmt, 1);
 
-	std::string 
-	data_name = element_name;
+	get_column_text(sql_stmt, 2, feed_item.pubdate);
+	get_column_text(sql_stmt, 3, feed_item.title);
+	get_column_text(sql_stmt, 4, feed_item.link);
+	get_column_text(sql_stmt, 5, feed_item.description);
 
-	if(!data_name.empty())
-	{
-		std::transform(data_name.begin(), data_name.end(), data_name.begin(), switch_letter_case);
+	feed_item.pub_date_epoch = sqlite3_column_int64(sql_stmt, 6);
+
+	return;
+}
+
+//Adds the feed item in the current row to the list for its feed.
+//Rows arrive grouped by feed name, so the list is only looked up when the name changes.
+static void 
+add_feed_item_row(sqlite3_stmt* sql_stmt, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>::iterator& feed_position)
+{
+	const char* feed_name = 
+	reinterpret_cast<const char*>(sqlite3_column_text(sql_stmt, 0));
 
-		auto found = 
-		std::find(_element_names.cbegin(), _element_names.cend(), data_name);
+	const auto feed_name_size = 
+	static_cast<std::string::size_type>(sqlite3_column_bytes(sql_stmt, 0));
 
-		match_found = (found != _element_names.cend());
+	if(!feed_name)
+	{
+		feed_name = "";
 	}
 
-	return match_found;
-}
+	if(feed_position == rss_feed_items.end() || feed_position->first.compare(0, std::string::npos, feed_name, feed_name_size) != 0)
+	{
+		feed_position = 
+		rss_feed_items.emplace(std::string(feed_name, feed_name_size), std::vector<gautier::rss_model::unit_type_rss_item>()).first;
+	}
 
-//The goal of the following operations is to produce a data structure of type std::map<std::string, std::vector<std::map<std::string, std::string>>>.
-//Manage access to a database that contains the data used to form the data structure.
+	feed_position->second.emplace_back();
 
-//SQL: Database infrastructure/tables.
+	make_feed_item(sql_stmt, feed_position->second.back());
 
-//The following functions under this section deals with supporting database structures for the rss engine.
+	return;
+}
 
-//Governs the deallocation of an sqlite3 pointer through a pointer resource handle.
+//Feed items of all feeds, grouped by feed name, in publication order.
+//Sorting on the source id after the name lets both indexes supply the order, so no sort is done.
 static void 
-db_connection_guard_finalize(sqlite3* obj)
+make_feed_items_query(std::string& sql_text)
 {
-	if(obj)
+	sql_text = 
+	"SELECT \
+		fs.name AS feed_name, \
+		fd.id, \
+		fd.pub_date, \
+		fd.title, \
+		fd.link, \
+		fd.description, \
+		fd.pub_date_epoch \
+	FROM rss_feed_source AS fs INNER JOIN \
+	rss_feed_data AS fd ON fs.id = fd.rss_feed_source_id \
+	ORDER BY \
+		 fs.name, \
+		 fs.id, \
+		 fd.pub_date_epoch, \
+		 fd.id;\
+	";
+
+	return;
+}
+
+//Feed items of one feed source, matched by id or, when the id is not known, by name.
+//sql_text is left empty when the feed source has neither.
+//A name is resolved to an id first so the rows come out of rss_feed_data_source_pub_date_epoch_ix already in order.
+static void 
+make_feed_items_query(const gautier::rss_model::unit_type_rss_source& feed_source, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values)
+{
+	if(feed_source.id > 0)
 	{
-		sqlite3_close(obj);
+		sql_text = 
+		"SELECT \
+			fs.name AS feed_name, \
+			fd.id, \
+			fd.pub_date, \
+			fd.title, \
+			fd.link, \
+			fd.description, \
+			fd.pub_date_epoch \
+		FROM rss_feed_source AS fs INNER JOIN \
+		rss_feed_data AS fd ON fs.id = fd.rss_feed_source_id \
+		WHERE fs.id = @id \
+		ORDER BY \
+			 fd.pub_date_epoch, \
+			 fd.id;\
+		";
+
+		parameter_values.push_back(create_binding("@id", std::to_string(feed_source.id), parameter_data_type::integer));
+	}
+	else if(!feed_source.name.empty())
+	{
+		sql_text = 
+		"SELECT \
+			fs.name AS feed_name, \
+			fd.id, \
+			fd.pub_date, \
+			fd.title, \
+			fd.link, \
+			fd.description, \
+			fd.pub_date_epoch \
+		FROM rss_feed_source AS fs INNER JOIN \
+		rss_feed_data AS fd ON fs.id = fd.rss_feed_source_id \
+		WHERE fs.id = (SELECT id FROM rss_feed_source WHERE name = @feed_name) \
+		ORDER BY \
+			 fd.pub_date_epoch, \
+			 fd.id;\
+		";
+
+		parameter_values.push_back(create_binding("@feed_name", feed_source.name, parameter_data_type::text));
 	}
 
 	return;
 }
 
-//Make a database file if one does not exist.
-//Not currently a halting error if this fails. 
-//Rather, the process fails silently if a database cannot be made available.
-static bool 
-db_check_database_exist(sqlite3** db_connection)
+//One page of the feed items of one feed source, in the order of make_feed_items_query, following the cursor.
+//The cursor condition is written so the pub_date_epoch bound is a range on rss_feed_data_source_pub_date_epoch_ix.
+static void 
+make_feed_page_query(const gautier::rss_model::unit_type_rss_source& feed_source, const int page_size, const gautier::rss_model::unit_type_feed_page_cursor& cursor, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values)
 {
-	bool success = false;
-
-	auto sqlite_options = (SQLITE_OPEN_PRIVATECACHE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+	std::string 
+	feed_source_condition{};
 
-	const auto open_result = 
-	sqlite3_open_v2(_rss_database_name.data(), db_connection, sqlite_options, nullptr);
+	if(feed_source.id > 0)
+	{
+		feed_source_condition = "fs.id = @id";
 
-	if(open_result == SQLITE_OK && db_connection)
+		parameter_values.push_back(create_binding("@id", std::to_string(feed_source.id), parameter_data_type::integer));
+	}
+	else if(!feed_source.name.empty())
 	{
-		success = true;
+		//Resolved to an id first so the rows come out of the index already in order.
+		feed_source_condition = "fs.id = (SELECT id FROM rss_feed_source WHERE name = @feed_name)";
+
+		parameter_values.push_back(create_binding("@feed_name", feed_source.name, parameter_data_type::text));
 	}
 	else
 	{
-		std::cout 
-		<< "unable to open database.\n";
+		return;
 	}
 
-	return success;
+	sql_text = 
+	"SELECT \
+		fs.name AS feed_name, \
+		fd.id, \
+		fd.pub_date, \
+		fd.title, \
+		fd.link, \
+		fd.description, \
+		fd.pub_date_epoch \
+	FROM rss_feed_source AS fs INNER JOIN \
+	rss_feed_data AS fd ON fs.id = fd.rss_feed_source_id \
+	WHERE " + feed_source_condition + " \
+	AND fd.pub_date_epoch >= @pub_date_epoch \
+	AND (fd.pub_date_epoch > @pub_date_epoch OR fd.id > @item_id) \
+	ORDER BY \
+		 fd.pub_date_epoch, \
+		 fd.id \
+	LIMIT @page_size;\
+	";
+
+	parameter_values.push_back(create_binding("@pub_date_epoch", std::to_string(cursor.pub_date_epoch), parameter_data_type::integer));
+	parameter_values.push_back(create_binding("@item_id", std::to_string(cursor.id), parameter_data_type::integer));
+	parameter_values.push_back(create_binding("@page_size", std::to_string(page_size), parameter_data_type::integer));
+
+	return;
 }
 
-//Examines the database for the existence of tables.
-//Uses an aggregate function to determine if a table exists.
-//If the table does not exist, dispatches a call to db_create_table, to define the table in the database.
-static bool 
-db_check_tables_exist(sqlite3** db_connection)
+//Runs a DELETE of at most batch_size rows until it removes fewer, each run in its own transaction.
+//Saving feeds waits on one batch at most rather than on the whole purge.
+//Returns the number of rows removed.
+static long long 
+purge_rows(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values, const int batch_size)
 {
-	bool success = false;
+	long long purged_count = 0;
 
-	if(db_connection)
+	int batch_count = 0;
+
+	do
 	{
-		const auto expected = _table_names.size();
+		db_transact_begin(db_connection);
 
-		decltype(_table_names)::size_type actual = 0;
+		const bool success = apply_sql(db_connection, sql_text, parameter_values, nullptr).first;
 
-		for(const std::string& table_name : _table_names)
-		{
-			std::string 
-			sql_text = 
-			"SELECT \
-			 	COUNT(*) AS row_count \
-			FROM sqlite_master \
-			WHERE type='table' \
-			  AND name = @table_name; \
-			";
+		batch_count = success ? sqlite3_changes(*db_connection) : 0;
 
-			std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
-			{
-				create_binding("@table_name", table_name, parameter_data_type::text)
-			};
-
-			std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values;
-			query_values.reset(new std::vector<std::map<std::string, std::string>>);
-
-			apply_sql(db_connection, sql_text, parameter_values, query_values);
-
-			if(query_values)
-			{
-				const auto row_count = 
-				std::stoul(get_first_db_column_value(query_values->front(), "row_count"));
-
-				const bool exists = (row_count > 0);
-
-				if(exists)
-				{
-					actual++;//note the existence of the table.
-				}
-				else//not exists
-				{
-					const bool table_created = 
-					db_create_table(db_connection, table_name);
-
-					if(table_created)
-					{
-						actual++;//note its existence.
-					}
-				}
-			}
-		}
+		db_transact_end(db_connection);
 
-		success = (actual == expected);
+		purged_count += batch_count;
 	}
+	while(batch_count >= batch_size);
 
-	return success;
+	return purged_count;
 }
 
-//Defines tables in the relational database used by the rss engine.
-static bool 
-db_create_table(sqlite3** db_connection, const std::string& table_name)
+//Turns words typed by a user into an FTS5 query that matches items containing all of them.
+//Each word is quoted so punctuation in it is not read as query syntax.
+//The last word also matches longer words starting with it, so results appear while it is being typed.
+//	Not for one or two letters, which start too many words to rank them quickly.
+static std::string 
+make_search_match_text(const std::string& search_text)
 {
-	bool success = false;
+	std::string 
+	match_text{};
 
-	if(db_connection)
+	std::string::size_type 
+		word_start = search_text.find_first_not_of(" \t\r\n"),
+		last_word_size = 0
+	;
+
+	while(word_start != std::string::npos)
 	{
-		std::string db_create_table_statement_text = "";
+		const auto word_end = search_text.find_first_of(" \t\r\n", word_start);
 
-		if(table_name == "rss_feed_source")
-		{
-			db_create_table_statement_text = 
-			"CREATE TABLE " + table_name + "\
-			(\
-				id INTEGER PRIMARY KEY ASC,\
-				type_code INTEGER DEFAULT 1,\
-				entry_date TEXT DEFAULT (datetime(CURRENT_TIMESTAMP, 'localtime')),\
-				name TEXT NOT NULL COLLATE NOCASE,\
-				url TEXT NOT NULL COLLATE NOCASE\
-			 );\
-			 ";
-		}
-		else if(table_name == "rss_feed_data" || table_name == "rss_feed_data_staging")
+		if(!match_text.empty())
 		{
-			db_create_table_statement_text = 
-			"CREATE TABLE " + table_name + "\
-			(\
-				id INTEGER PRIMARY KEY ASC,\
-				rss_feed_source_id INTEGER NOT NULL,\
-				entry_date TEXT DEFAULT (datetime(CURRENT_TIMESTAMP, 'localtime')),\
-				pub_date TEXT NOT NULL,\
-				title TEXT NOT NULL COLLATE NOCASE,\
-				link TEXT NOT NULL COLLATE NOCASE,\
-				description TEXT NOT NULL COLLATE NOCASE\
-			 );\
-			 ";
+			match_text += ' ';
 		}
 
-		if(!db_create_table_statement_text.empty())
-		{
-			char* error_message = 0;
+		match_text += '"';
 
-			const auto sqlite_result = 
-			sqlite3_exec(*db_connection, db_create_table_statement_text.data(), nullptr, nullptr, &error_message);
+		for(auto character_n = word_start; character_n < search_text.size() && character_n < word_end; character_n++)
+		{
+			const char character = search_text[character_n];
 
-			if(sqlite_result == SQLITE_OK)
-			{
-				success = true;
-			}
-			else
+			//A quote inside a quoted word is written twice.
+			if(character == '"')
 			{
-				output_op_sql_error_message(&error_message, __LINE__);
+				match_text += '"';
 			}
+
+			match_text += character;
 		}
-	}
 
-	return success;
-}
+		match_text += '"';
 
-static bool 
-db_transact_begin(sqlite3** db_connection)
-{
-	static std::string 
-	sql_text = "BEGIN IMMEDIATE TRANSACTION";
+		last_word_size = std::min(word_end, search_text.size()) - word_start;
 
-	auto sqlite_result = 
-	apply_sql(db_connection, sql_text, _empty_param_set, nullptr);
+		word_start = search_text.find_first_not_of(" \t\r\n", word_end);
+	}
 
-	return sqlite_result.first;
+	if(last_word_size > 2)
+	{
+		match_text += '*';
+	}
+
+	return match_text;
 }
 
-static bool 
-db_transact_end(sqlite3** db_connection)
+//Hands each row of a feed items query to the visitor as it is stepped.
+//The same item and feed name are filled in again for every row, so their buffers are reused.
+static void 
+visit_feed_items(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_values, const gautier::rss_model::type_feed_item_visitor& feed_item_visitor)
 {
-	static std::string 
-	sql_text = "COMMIT TRANSACTION";
+	if(!feed_item_visitor)
+	{
+		return;
+	}
 
-	auto sqlite_result = 
-	apply_sql(db_connection, sql_text, _empty_param_set, nullptr);
+	std::string 
+	feed_name{};
 
-	return sqlite_result.first;
-}
+	gautier::rss_model::unit_type_rss_item 
+	feed_item;
 
-//SQL: Queries
+	apply_sql(db_connection, sql_text, parameter_values, [&feed_name, &feed_item, &feed_item_visitor](sqlite3_stmt* sql_stmt)
+	{
+		get_column_text(sql_stmt, 0, feed_name);
 
-//Links a named parameter to data value for use in a parameterized sql statement.
-static std::tuple<std::string, std::string, parameter_data_type> 
-create_binding(const std::string name, const std::string value, const parameter_data_type parameter_type)
-{
-	return std::tuple<std::string, std::string, parameter_data_type>(name, value, parameter_type);
+		make_feed_item(sql_stmt, feed_item);
+
+		feed_item_visitor(feed_name, feed_item);
+	});
+
+	return;
 }
 
-//Execute an sql statement.
-//At the same level as the sqlite3_exec function.
-//The sqlite3_exec function is the preferred way for any readonly queries that do not take parameters.
-//The primary use of this function is to introduce parameters to an sql statement.
-//Otherwise, it produces the same output as the sqlite3_exec callback for this module, translate_sql_result.
-//A noteable difference with this function versus translate_sql_result is that this function will 
-//	immediately output all error messages to std out rather than return an error data structure.
-//As a result, the return SQLITE result code/error code is primarily for control caller control flow.
-static std::pair<bool, int> 
-apply_sql(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_binding_infos, std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values)
+//Retrieves rss data at a given url and decodes the XML into the feed items of each feed source that is due.
+//Network locations are downloaded by curl and parsed while they arrive. Other locations are read by the xml library.
+//Feed sources are retrieved by a bounded set of worker threads so the total time
+//	is close to that of the slowest feed rather than the sum of all feeds.
+//Each worker writes the items of a feed to the slot for that feed, then reports the feed as completed.
+//	This thread passes each completed feed to feed_collected right away, while the others are still downloading,
+//	and frees its slot. feed_collected always runs on this thread, one feed at a time.
+//fetched_sources and fetch_statuses list every due feed source, with its outcome, once all are done.
+static void 
+collect_feed_items_from_rss(const std::map<std::string, gautier::rss_model::unit_type_rss_source>& feed_sources, const type_feed_collected& feed_collected, std::vector<gautier::rss_model::unit_type_rss_source>& fetched_sources, std::vector<feed_fetch_status>& fetch_statuses, const std::atomic<bool>* stop_requested)
 {
-	bool success = false;
-	int row_count = -1;
+	//Copies, since workers record the cache validators of each download in them.
+	std::vector<gautier::rss_model::unit_type_rss_source> pending_sources;
 
-	sqlite3_stmt* sql_stmt = nullptr;
+	for(auto& feed_source : feed_sources)
+	{
+		if(feed_source.second.type_code == 3)//collect from feeds past expire date.
+		{
+			pending_sources.push_back(feed_source.second);
+		}
+	}
 
-	if(!db_connection || sql_text.empty())
+	if(pending_sources.empty())
 	{
-		return std::pair<bool, int>(success, row_count);
+		return;
 	}
 
-	auto sqlite_prepare_result = SQLITE_BUSY;
+	//The readers have to be initialized on this thread before any worker uses them.
+	init_feed_readers();
+
+	const type_list_size pending_count = pending_sources.size();
+
+	std::vector<std::vector<gautier::rss_model::unit_type_rss_item>> collected_items(pending_count);
+	std::vector<feed_fetch_status> pending_statuses(pending_count, fetch_failed);
+
+	feed_collect_schedule schedule;
+
+	schedule.taken.assign(pending_count, 0);
+	schedule.remaining = pending_count;
+	schedule.stop_requested = stop_requested;
+
+	for(const auto& feed_source : pending_sources)
 	{
-		const char* sql_char_ptr = sql_text.data();
-		int sql_char_ptr_sz = -1;
+		schedule.hosts.push_back(get_url_host(feed_source.url));
+	}
+
+	const type_list_size worker_count = 
+	std::min(pending_count, static_cast<type_list_size>(_collect_max_connections));
 
-		sqlite_prepare_result = 
-		sqlite3_prepare_v2(*db_connection, sql_char_ptr, sql_char_ptr_sz, &sql_stmt, nullptr);
+	std::vector<std::thread> workers;
+
+	workers.reserve(worker_count);
+
+	for(type_list_size worker_n = 0; worker_n < worker_count; worker_n++)
+	{
+		workers.emplace_back(collect_feed_items_worker, std::ref(schedule), std::ref(pending_sources), std::ref(collected_items), std::ref(pending_statuses));
 	}
 
-	if(sqlite_prepare_result == SQLITE_OK)
+	//Each feed is handed over as soon as its worker finishes, while the remaining feeds are still downloading.
+	type_list_size reported_count = 0;
+
+	while(reported_count < pending_count)
 	{
-		int params_count = 0;
+		std::vector<type_list_size> completed;
 
-		//Binding the input values to the input sql statement.
-		for(auto& bind_info : parameter_binding_infos)
 		{
-			params_count++;
+			std::unique_lock<std::mutex> schedule_guard(schedule.lock);
 
-			int param_n = params_count;
+			schedule.feed_completed.wait(schedule_guard, [&schedule]
+			{
+				return !schedule.completed.empty();
+			});
 
-			const std::string parameter_name = std::get<0>(bind_info);
-			const std::string parameter_text = std::get<1>(bind_info);
-			const parameter_data_type param_t = std::get<2>(bind_info);
+			completed.swap(schedule.completed);
+		}
 
-			auto sqlite_result = 0;
+		for(const auto source_n : completed)
+		{
+			reported_count++;
 
-			if(param_t == parameter_data_type::text)
+			if(pending_statuses[source_n] == fetch_collected)
 			{
-				const char* param_char_ptr = parameter_text.data();
-				const int param_char_ptr_sz = -1;
+				feed_collected(pending_sources[source_n], collected_items[source_n]);
 
-				sqlite3_bind_text(sql_stmt, param_n, param_char_ptr, param_char_ptr_sz, SQLITE_TRANSIENT);
+				std::vector<gautier::rss_model::unit_type_rss_item>().swap(collected_items[source_n]);
 			}
-			else if(param_t == parameter_data_type::integer)
-			{
-				const int param_value = std::stoi(parameter_text);
+		}
+	}
 
-				sqlite3_bind_int(sql_stmt, param_n, param_value);
-			}
-			else
+	for(auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	fetched_sources = std::move(pending_sources);
+	fetch_statuses = std::move(pending_statuses);
+
+	return;
+}
+
+//Takes the next feed source whose host is under its connection limit, retrieves it and repeats.
+//Waits for another worker to finish with a host when every remaining source is on a busy host.
+static void 
+collect_feed_items_worker(feed_collect_schedule& schedule, std::vector<gautier::rss_model::unit_type_rss_source>& pending_sources, std::vector<std::vector<gautier::rss_model::unit_type_rss_item>>& collected_items, std::vector<feed_fetch_status>& fetch_statuses)
+{
+	const type_list_size pending_count = pending_sources.size();
+
+	while(true)
+	{
+		type_list_size source_n = pending_count;
+
+		{
+			std::unique_lock<std::mutex> schedule_guard(schedule.lock);
+
+			while(source_n == pending_count)
 			{
-				if(param_t != parameter_data_type::none)
+				if(schedule.remaining == 0)
 				{
-					std::cout 
-					<< "parameter " << parameter_name 
-					<< " data type not mapped.\n";
+					return;
 				}
-			}
 
-			if(sqlite_result != SQLITE_OK)
-			{
-				output_op_sql_error_message(db_connection, __LINE__);
+				for(type_list_size candidate_n = 0; candidate_n < pending_count; candidate_n++)
+				{
+					if(!schedule.taken[candidate_n] && schedule.host_connections[schedule.hosts[candidate_n]] < _collect_max_connections_per_host)
+					{
+						source_n = candidate_n;
 
-				break;
+						break;
+					}
+				}
+
+				if(source_n == pending_count)
+				{
+					schedule.host_released.wait(schedule_guard);
+				}
 			}
-		}
 
-		if(static_cast<type_list_size>(params_count) != parameter_binding_infos.size())
-		{
-			success = false;
+			schedule.taken[source_n] = 1;
+			schedule.remaining--;
+			schedule.host_connections[schedule.hosts[source_n]]++;
+		}
 
-			std::cout 
-			<< "could not bind params to: " << sql_text 
-			<< "\n";
+		std::vector<gautier::rss_model::unit_type_rss_item>& feed_items = 
+		collected_items[source_n];
 
-			std::cout 
-			<< "total parameters : " << parameter_binding_infos.size() 
-			<< "\n";
+		feed_items.reserve(_list_reserve_size);
 
-			for(auto& diag_bind_info : parameter_binding_infos)
-			{
-				std::cout 
-				<< std::get<0>(diag_bind_info) << " | " 
-				<< std::get<1>(diag_bind_info) << " | " 
-				<< std::to_string(static_cast<type_list_size>(std::get<2>(diag_bind_info))) 
-				<< "\n";
-			}
+		//Feeds left once a stop is requested are still handed out, so each one is reported to the caller.
+		if(is_stop_requested(schedule.stop_requested))
+		{
+			fetch_statuses[source_n] = fetch_stopped;
 		}
 		else
 		{
-			//Run the SQL.
-			auto sqlite_result = SQLITE_BUSY;
+			//An unchanged feed is left out, as if it had no new items.
+			fetch_statuses[source_n] = 
+			collect_feed_items_from_source(pending_sources[source_n], feed_items, schedule.stop_requested);
+		}
 
-			if(!sqlite3_stmt_readonly(sql_stmt))
-			{
-				sqlite_result = 
-				sqlite3_step(sql_stmt);
-			}
-			else
-			{
-				do
-				{
-					sqlite_result = 
-					sqlite3_step(sql_stmt);
+		{
+			std::lock_guard<std::mutex> schedule_guard(schedule.lock);
 
-					if(sqlite_result == SQLITE_ROW)
-					{
-						success = 
-						translate_sql_result(query_values, sql_stmt);
-					}
-				}while(sqlite_result != SQLITE_DONE);
-			}
+			schedule.host_connections[schedule.hosts[source_n]]--;
+			schedule.completed.push_back(source_n);
+		}
 
-			if(sqlite_result == SQLITE_DONE)
-			{
-				success = true;
+		schedule.host_released.notify_all();
+		schedule.feed_completed.notify_one();
+	}
 
-				row_count = sqlite3_changes(*db_connection);
-			}
-			else
-			{
-				success = false;//undoing any success up to this point.
+	return;
+}
 
-				output_op_sql_error_message(db_connection, __LINE__);
-			}
-		}
+//stop_requested is null for reads that are not part of a collection, which are never stopped.
+static bool 
+is_stop_requested(const std::atomic<bool>* stop_requested)
+{
+	return (stop_requested && *stop_requested);
+}
+
+//Called once per collection before feeds are read, on the thread that starts the workers.
+static void 
+init_feed_readers()
+{
+	//see libxml2 tree1.c example file for the general structure used.
+	LIBXML_TEST_VERSION
+
+	//xmlCleanupParser is no longer called per document since other workers may still be parsing.
+	xmlInitParser();
+
+	//curl_global_init is not thread safe. Local static initialization runs it once.
+	static const bool network_ready = (curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK);
+
+	if(!network_ready)
+	{
+		std::cout << "network transfers are not available, see:" << __func__ << "\n";
+	}
+
+	return;
+}
+
+//Feeds on the network are downloaded with conditional requests. Other locations are read as files.
+static feed_fetch_status 
+collect_feed_items_from_source(gautier::rss_model::unit_type_rss_source& feed_source, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, const std::atomic<bool>* stop_requested)
+{
+	feed_fetch_status fetch_status = fetch_failed;
+
+	if(is_network_location(feed_source.url))
+	{
+		fetch_status = collect_feed_items_from_network(feed_source, feed_items, stop_requested);
+	}
+	else
+	{
+		feed_refresh_hints refresh_hints;
+
+		const auto parse_start = std::chrono::steady_clock::now();
+
+		const bool items_read = 
+		collect_feed_items_from_stream(feed_source.url, feed_items, refresh_hints);
+
+		if(_metrics_enabled)
+		{
+			gautier::rss_model::unit_type_feed_metrics feed_counts;
+
+			feed_counts.items_parsed = static_cast<long long>(feed_items.size());
+
+			record_feed_counts(feed_source.name, feed_counts);
+			record_stage_time("parse", feed_source.name, std::chrono::steady_clock::now() - parse_start);
+		}
+
+		if(items_read)
+		{
+			fetch_status = fetch_collected;
+
+			feed_source.ttl_minutes = refresh_hints.ttl_minutes;
+			feed_source.skip_hours = refresh_hints.skip_hours;
+			feed_source.skip_days = refresh_hints.skip_days;
+		}
+	}
+
+	return fetch_status;
+}
+
+//Sends the saved ETag and Last-Modified values so an unchanged feed is not downloaded again.
+//The response is parsed while it downloads. New validators are kept in feed_source once the items are read.
+static feed_fetch_status 
+collect_feed_items_from_network(gautier::rss_model::unit_type_rss_source& feed_source, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, const std::atomic<bool>* stop_requested)
+{
+	feed_fetch_status fetch_status = fetch_failed;
+
+	const auto fetch_start = std::chrono::steady_clock::now();
+
+	feed_download download;
+
+	download.stop_requested = stop_requested;
+
+	curl_slist* request_headers = 
+	curl_slist_append(nullptr, _fetch_accept_encoding.data());
+
+	if(!feed_source.etag.empty())
+	{
+		request_headers = curl_slist_append(request_headers, ("If-None-Match: " + feed_source.etag).data());
+	}
+
+	if(!feed_source.last_modified.empty())
+	{
+		request_headers = curl_slist_append(request_headers, ("If-Modified-Since: " + feed_source.last_modified).data());
+	}
+
+	download.transfer = curl_easy_init();
+	download.transfer_driver = curl_multi_init();
+
+	if(download.transfer && download.transfer_driver)
+	{
+		curl_easy_setopt(download.transfer, CURLOPT_URL, feed_source.url.data());
+		curl_easy_setopt(download.transfer, CURLOPT_USERAGENT, _fetch_user_agent.data());
+		curl_easy_setopt(download.transfer, CURLOPT_HTTPHEADER, request_headers);
+		//feed_download_write decodes the body.
+		curl_easy_setopt(download.transfer, CURLOPT_HTTP_CONTENT_DECODING, 0L);
+		curl_easy_setopt(download.transfer, CURLOPT_FOLLOWLOCATION, 1L);
+		curl_easy_setopt(download.transfer, CURLOPT_MAXREDIRS, _fetch_max_redirects);
+		curl_easy_setopt(download.transfer, CURLOPT_CONNECTTIMEOUT, _fetch_connect_timeout_seconds);
+		curl_easy_setopt(download.transfer, CURLOPT_LOW_SPEED_LIMIT, 1L);
+		curl_easy_setopt(download.transfer, CURLOPT_LOW_SPEED_TIME, _fetch_stall_timeout_seconds);
+		//Workers run the transfers. Signals would reach the wrong thread.
+		curl_easy_setopt(download.transfer, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(download.transfer, CURLOPT_WRITEFUNCTION, feed_download_write);
+		curl_easy_setopt(download.transfer, CURLOPT_WRITEDATA, &download);
+		curl_easy_setopt(download.transfer, CURLOPT_HEADERFUNCTION, feed_download_header);
+		curl_easy_setopt(download.transfer, CURLOPT_HEADERDATA, &download);
+
+		curl_multi_add_handle(download.transfer_driver, download.transfer);
+
+		//Headers are complete once the body starts or the transfer ends.
+		feed_download_advance(download);
+
+		long response_code = 0;
+
+		curl_easy_getinfo(download.transfer, CURLINFO_RESPONSE_CODE, &response_code);
+
+		if(response_code == 304)
+		{
+			fetch_status = fetch_not_modified;
+		}
+		else if(download.content_coding == coding_unsupported)
+		{
+			//feed_download_write ended the transfer at the start of the body.
+			download.result = CURLE_BAD_CONTENT_ENCODING;
+		}
+		else if(response_code >= 200 && response_code < 300)
+		{
+			xmlTextReaderPtr xml_reader = 
+			xmlReaderForIO(feed_download_read, feed_download_close, &download, feed_source.url.data(), nullptr, _xml_parse_options);
+
+			if(xml_reader)
+			{
+				feed_refresh_hints refresh_hints;
+
+				//A transfer cut short may still parse, in recovery mode, as a shorter document.
+				const bool items_read = 
+				collect_feed_items(xml_reader, feed_items, refresh_hints);
+
+				//Compressed data that ends before the end of its stream was cut short as well.
+				if(download.result == CURLE_OK && download.content_coding != coding_identity && !download.decoder_finished)
+				{
+					download.result = CURLE_BAD_CONTENT_ENCODING;
+				}
+
+				if(items_read && download.result == CURLE_OK)
+				{
+					fetch_status = fetch_collected;
+
+					feed_source.etag = download.etag;
+					feed_source.last_modified = download.last_modified;
+					feed_source.ttl_minutes = refresh_hints.ttl_minutes;
+					feed_source.skip_hours = refresh_hints.skip_hours;
+					feed_source.skip_days = refresh_hints.skip_days;
+				}
+
+				xmlFreeTextReader(xml_reader);
+
+				if(_metrics_enabled)
+				{
+					gautier::rss_model::unit_type_feed_metrics feed_counts;
+
+					feed_counts.items_parsed = static_cast<long long>(feed_items.size());
+
+					record_feed_counts(feed_source.name, feed_counts);
+					record_stage_time("parse", feed_source.name, std::chrono::steady_clock::now() - fetch_start - download.network_time);
+				}
+			}
+		}
+
+		if(_metrics_enabled)
+		{
+			gautier::rss_model::unit_type_feed_metrics feed_counts;
+
+			feed_counts.bytes_fetched = download.bytes_received;
+
+			record_feed_counts(feed_source.name, feed_counts);
+			record_stage_time("fetch", feed_source.name, download.network_time);
+		}
+
+		if(download.result == CURLE_ABORTED_BY_CALLBACK)
+		{
+			fetch_status = fetch_stopped;
+		}
+		else if(fetch_status == fetch_failed)
+		{
+			std::cout 
+			<< "could not download feed " 
+			<< feed_source.name << " @ " << feed_source.url << ", " 
+			<< ((download.result == CURLE_OK) ? "HTTP status " + std::to_string(response_code) : curl_easy_strerror(download.result)) 
+			<< ", see:" 
+			<< __func__ 
+			<< "\n";
+		}
+
+		save_feed_transfer(feed_source.name, download, response_code);
+
+		curl_multi_remove_handle(download.transfer_driver, download.transfer);
+	}
+
+	feed_download_end_decode(download);
+
+	if(download.transfer_driver)
+	{
+		curl_multi_cleanup(download.transfer_driver);
+	}
+
+	if(download.transfer)
+	{
+		curl_easy_cleanup(download.transfer);
+	}
+
+	curl_slist_free_all(request_headers);
+
+	return fetch_status;
+}
+
+//Retrieves and parses a single feed document.
+//Returns false if the document could not be read.
+static bool 
+collect_feed_items_from_document(const std::string& feed_url, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)
+{
+	bool success = false;
+
+	xmlDoc *doc = 
+	xmlReadFile(feed_url.data(), nullptr, _xml_parse_options);
+
+	if(doc)
+	{
+		xmlNode *root_element = 
+		xmlDocGetRootElement(doc);
+
+		if(root_element)
+		{
+			collect_feed_items(root_element, feed_items);
+
+			success = true;
+		}
+
+		xmlFreeDoc(doc);
+	}
+
+	return success;
+}
+
+//Retrieves and parses a single feed document without building the document tree.
+//Memory use stays flat regardless of the size of the document.
+//Returns false if the document could not be read.
+static bool 
+collect_feed_items_from_stream(const std::string& feed_url, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, feed_refresh_hints& refresh_hints)
+{
+	bool success = false;
+
+	xmlTextReaderPtr xml_reader = 
+	xmlReaderForFile(feed_url.data(), nullptr, _xml_parse_options);
+
+	if(xml_reader)
+	{
+		success = collect_feed_items(xml_reader, feed_items, refresh_hints);
+
+		xmlFreeTextReader(xml_reader);
+	}
+
+	return success;
+}
+
+//See libxml2 tree1.c example file for the general structure used. 9/24/2015
+static void 
+collect_feed_items(xmlNode* xml_element, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)
+{
+	for(xmlNode* current_node = xml_element; (current_node != nullptr); current_node = current_node->next)
+	{
+		if(current_node->type == XML_ELEMENT_NODE)
+		{
+			const feed_element_name current_name = 
+			get_feed_element_name(current_node->name);
+
+			if(current_name == element_item)
+			{
+				feed_items.push_back(gautier::rss_model::unit_type_rss_item());
+			}
+			else if(current_name != element_other && !feed_items.empty() && current_node->parent && xmlStrEqual(current_node->parent->name, BAD_CAST "item") == 1)
+			{
+				std::string* field = 
+				get_feed_item_field(current_name, feed_items.back());
+
+				if(field)
+				{
+					xmlChar* node_value = 
+					xmlNodeGetContent(current_node);
+
+					if(node_value)
+					{
+						field->assign(reinterpret_cast<const char*>(node_value));
+
+						xmlFree(node_value);
+					}
+					else
+					{
+						field->clear();
+					}
+				}
+			}
+		}
+
+		collect_feed_items(current_node->children, feed_items);
+	}
+
+	return;
+}
+
+//Streaming counterpart of the document tree walk above.
+//Reads up to the root element, then hands the rest of the document to the reader for its format.
+//Returns false if the document has no root element.
+static bool 
+collect_feed_items(xmlTextReaderPtr xml_reader, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, feed_refresh_hints& refresh_hints)
+{
+	bool root_found = false;
+
+	while(!root_found && xmlTextReaderRead(xml_reader) == 1)
+	{
+		root_found = (xmlTextReaderNodeType(xml_reader) == XML_READER_TYPE_ELEMENT);
+	}
+
+	if(root_found)
+	{
+		const feed_element_name root_name = 
+		get_feed_element_name(xmlTextReaderConstLocalName(xml_reader));
+
+		if(root_name == element_feed)
+		{
+			collect_atom_entries(xml_reader, feed_items);
+		}
+		else
+		{
+			collect_rss_items(xml_reader, (root_name == element_rdf) ? format_rdf : format_rss, feed_items, refresh_hints);
+		}
+	}
+
+	return root_found;
+}
+
+//Reads RSS items, starting at the root element. Produces the same items as the document tree walk,
+//	except that RSS 1.0 items also take their pubdate from a dc:date element.
+//Each item is added to feed_items when its closing tag is read.
+//Element data is taken from the text of the element and its descendants,
+//	which is what xmlNodeGetContent returns in the document tree version.
+static void 
+collect_rss_items(xmlTextReaderPtr xml_reader, const feed_format format, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items, feed_refresh_hints& refresh_hints)
+{
+	//Items that have been opened but not yet closed.
+	//Only more than one when items are nested.
+	struct open_feed_item
+	{
+		gautier::rss_model::unit_type_rss_item 
+			feed_item
+		;
+
+		int 
+			depth
+		;
+
+		bool 
+			//Data elements are only taken from items named exactly "item".
+			accepts_data
+		;
+	};
+
+	std::vector<open_feed_item> open_feed_items;
+
+	std::string* data_target = nullptr;
+	int data_depth = -1;
+
+	//Text of a ttl, hour or day element of the channel, applied to refresh_hints when the element ends.
+	std::string channel_value;
+	feed_element_name channel_value_name = element_other;
+
+	int 
+		skip_hours_depth = -1,
+		skip_days_depth = -1
+	;
+
+	do
+	{
+		const int node_type = xmlTextReaderNodeType(xml_reader);
+
+		if(node_type == XML_READER_TYPE_ELEMENT)
+		{
+			const int depth = xmlTextReaderDepth(xml_reader);
+			const bool is_empty = (xmlTextReaderIsEmptyElement(xml_reader) == 1);
+
+			const xmlChar* local_name = xmlTextReaderConstLocalName(xml_reader);
+
+			const feed_element_name current_name = 
+			get_feed_element_name(local_name);
+
+			if(current_name == element_item)
+			{
+				open_feed_item opened{gautier::rss_model::unit_type_rss_item(), depth, (xmlStrEqual(local_name, BAD_CAST "item") == 1)};
+
+				if(is_empty)
+				{
+					feed_items.push_back(std::move(opened.feed_item));
+				}
+				else
+				{
+					open_feed_items.push_back(std::move(opened));
+				}
+			}
+			else if(!data_target && open_feed_items.empty())
+			{
+				if(current_name == element_skiphours && !is_empty)
+				{
+					skip_hours_depth = depth;
+				}
+				else if(current_name == element_skipdays && !is_empty)
+				{
+					skip_days_depth = depth;
+				}
+				else if(!is_empty && (current_name == element_ttl || (current_name == element_hour && skip_hours_depth == depth - 1) || (current_name == element_day && skip_days_depth == depth - 1)))
+				{
+					channel_value.clear();
+					channel_value_name = current_name;
+
+					data_target = &channel_value;
+					data_depth = depth;
+				}
+			}
+			else if(!data_target && current_name != element_other)
+			{
+				if(open_feed_items.back().accepts_data && open_feed_items.back().depth == depth - 1)
+				{
+					std::string* field = 
+					get_feed_item_field((format == format_rdf && current_name == element_date) ? element_pubdate : current_name, open_feed_items.back().feed_item);
+
+					if(field)
+					{
+						field->clear();
+
+						if(!is_empty)
+						{
+							data_target = field;
+							data_depth = depth;
+						}
+					}
+				}
+			}
+		}
+		else if(node_type == XML_READER_TYPE_END_ELEMENT)
+		{
+			const int depth = xmlTextReaderDepth(xml_reader);
+
+			if(data_target && depth == data_depth)
+			{
+				if(data_target == &channel_value)
+				{
+					apply_refresh_hint(channel_value_name, channel_value, refresh_hints);
+				}
+
+				data_target = nullptr;
+				data_depth = -1;
+			}
+			else if(depth == skip_hours_depth)
+			{
+				skip_hours_depth = -1;
+			}
+			else if(depth == skip_days_depth)
+			{
+				skip_days_depth = -1;
+			}
+			else if(!open_feed_items.empty() && open_feed_items.back().depth == depth)
+			{
+				feed_items.push_back(std::move(open_feed_items.back().feed_item));
+
+				open_feed_items.pop_back();
+			}
+		}
+		else
+		{
+			append_text(xml_reader, node_type, data_target);
+		}
+	}while(xmlTextReaderRead(xml_reader) == 1);
+
+	//Items left open by a document that ends early are kept, as the recovering document parser would.
+	for(auto& opened : open_feed_items)
+	{
+		feed_items.push_back(std::move(opened.feed_item));
+	}
+
+	return;
+}
+
+//Reads Atom entries, starting at the root element.
+//Entry data maps to feed items as follows:
+//	link is the href of the alternate link, or of the first link when none is marked alternate.
+//	Without a link, the entry id is used, since saved items are told apart by link.
+//	description is the content, or the summary when there is no content.
+//	pubdate is the published date, or the updated date when there is no published date.
+static void 
+collect_atom_entries(xmlTextReaderPtr xml_reader, std::vector<gautier::rss_model::unit_type_rss_item>& feed_items)
+{
+	gautier::rss_model::unit_type_rss_item 
+	feed_item;
+
+	std::string 
+		entry_id,
+		entry_summary,
+		entry_updated
+	;
+
+	bool 
+		//Set once a link marked alternate is read. Later links do not replace it.
+		alternate_link_found = false
+	;
+
+	int entry_depth = -1;
+
+	std::string* data_target = nullptr;
+	int data_depth = -1;
+
+	do
+	{
+		const int node_type = xmlTextReaderNodeType(xml_reader);
+
+		if(node_type == XML_READER_TYPE_ELEMENT)
+		{
+			const int depth = xmlTextReaderDepth(xml_reader);
+			const bool is_empty = (xmlTextReaderIsEmptyElement(xml_reader) == 1);
+
+			const feed_element_name current_name = 
+			get_feed_element_name(xmlTextReaderConstLocalName(xml_reader));
+
+			if(entry_depth < 0)
+			{
+				if(current_name == element_entry && !is_empty)
+				{
+					entry_depth = depth;
+				}
+			}
+			else if(!data_target && depth == entry_depth + 1)
+			{
+				std::string* field = nullptr;
+
+				switch(current_name)
+				{
+					case element_title:
+						field = &feed_item.title;
+						break;
+					case element_content:
+						field = &feed_item.description;
+						break;
+					case element_published:
+						field = &feed_item.pubdate;
+						break;
+					case element_summary:
+						field = &entry_summary;
+						break;
+					case element_updated:
+						field = &entry_updated;
+						break;
+					case element_id:
+						field = &entry_id;
+						break;
+					case element_link:
+						if(!alternate_link_found)
+						{
+							std::string rel;
+
+							const bool is_alternate = (!get_attribute_value(xml_reader, "rel", rel) || rel == "alternate");
+
+							if(is_alternate || feed_item.link.empty())
+							{
+								get_attribute_value(xml_reader, "href", feed_item.link);
+
+								alternate_link_found = is_alternate;
+							}
+						}
+						break;
+					default:
+						break;
+				}
+
+				if(field)
+				{
+					field->clear();
+
+					if(!is_empty)
+					{
+						data_target = field;
+						data_depth = depth;
+					}
+				}
+			}
+		}
+		else if(node_type == XML_READER_TYPE_END_ELEMENT)
+		{
+			const int depth = xmlTextReaderDepth(xml_reader);
+
+			if(data_target && depth == data_depth)
+			{
+				data_target = nullptr;
+				data_depth = -1;
+			}
+			else if(depth == entry_depth)
+			{
+				if(feed_item.link.empty())
+				{
+					feed_item.link = std::move(entry_id);
+				}
+
+				if(feed_item.description.empty())
+				{
+					feed_item.description = std::move(entry_summary);
+				}
+
+				if(feed_item.pubdate.empty())
+				{
+					feed_item.pubdate = std::move(entry_updated);
+				}
+
+				feed_items.push_back(std::move(feed_item));
+
+				feed_item = gautier::rss_model::unit_type_rss_item();
+
+				entry_id.clear();
+				entry_summary.clear();
+				entry_updated.clear();
+
+				alternate_link_found = false;
+
+				entry_depth = -1;
+			}
+		}
+		else
+		{
+			append_text(xml_reader, node_type, data_target);
+		}
+	}while(xmlTextReaderRead(xml_reader) == 1);
+
+	return;
+}
+
+//Adds the text of the current node to data_target, when there is one.
+static void 
+append_text(xmlTextReaderPtr xml_reader, const int node_type, std::string* data_target)
+{
+	if(data_target && (node_type == XML_READER_TYPE_TEXT || node_type == XML_READER_TYPE_CDATA || node_type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE))
+	{
+		const xmlChar* node_value = xmlTextReaderConstValue(xml_reader);
+
+		if(node_value)
+		{
+			data_target->append(reinterpret_cast<const char*>(node_value));
+		}
+	}
+
+	return;
+}
+
+//Reads an attribute of the current element without allocating a copy in libxml2.
+//Returns false, leaving value unchanged, when the element does not have the attribute.
+static bool 
+get_attribute_value(xmlTextReaderPtr xml_reader, const char* attribute_name, std::string& value)
+{
+	bool found = false;
+
+	if(xmlTextReaderMoveToAttribute(xml_reader, BAD_CAST attribute_name) == 1)
+	{
+		const xmlChar* attribute_value = xmlTextReaderConstValue(xml_reader);
+
+		value = attribute_value ? reinterpret_cast<const char*>(attribute_value) : "";
+
+		found = true;
+
+		xmlTextReaderMoveToElement(xml_reader);
+	}
+
+	return found;
+}
+
+//Matches an element name without copying it. Letter case is ignored.
+//Names are told apart by length first, so each name is compared with a handful of candidates at most.
+static feed_element_name 
+get_feed_element_name(const xmlChar* element_name)
+{
+	feed_element_name matched_name = element_other;
+
+	const auto is_name = [element_name](const char* candidate)
+	{
+		return (xmlStrcasecmp(element_name, BAD_CAST candidate) == 0);
+	};
+
+	switch(xmlStrlen(element_name))
+	{
+		case 2:
+			matched_name = is_name("id") ? element_id : element_other;
+			break;
+		case 3:
+			matched_name = is_name("ttl") ? element_ttl : is_name("day") ? element_day : is_name("rss") ? element_rss : is_name("rdf") ? element_rdf : element_other;
+			break;
+		case 4:
+			matched_name = is_name("item") ? element_item : is_name("link") ? element_link : is_name("hour") ? element_hour : is_name("date") ? element_date : is_name("feed") ? element_feed : element_other;
+			break;
+		case 5:
+			matched_name = is_name("title") ? element_title : is_name("entry") ? element_entry : element_other;
+			break;
+		case 7:
+			matched_name = is_name("pubdate") ? element_pubdate : is_name("summary") ? element_summary : is_name("content") ? element_content : is_name("updated") ? element_updated : element_other;
+			break;
+		case 8:
+			matched_name = is_name("skipdays") ? element_skipdays : element_other;
+			break;
+		case 9:
+			matched_name = is_name("skiphours") ? element_skiphours : is_name("published") ? element_published : element_other;
+			break;
+		case 11:
+			matched_name = is_name("description") ? element_description : element_other;
+			break;
+	}
+
+	return matched_name;
+}
+
+//The field of a feed item that holds the data of an element. nullptr for other elements.
+static std::string* 
+get_feed_item_field(const feed_element_name element_name, gautier::rss_model::unit_type_rss_item& feed_item)
+{
+	std::string* field = nullptr;
+
+	switch(element_name)
+	{
+		case element_title:
+			field = &feed_item.title;
+			break;
+		case element_link:
+			field = &feed_item.link;
+			break;
+		case element_description:
+			field = &feed_item.description;
+			break;
+		case element_pubdate:
+			field = &feed_item.pubdate;
+			break;
+		default:
+			break;
+	}
+
+	return field;
+}
+
+//ttl is in minutes. hour is 0 to 23, GMT. day is a day name, Sunday to Saturday.
+//Values that do not fit are ignored.
+static void 
+apply_refresh_hint(const feed_element_name element_name, const std::string& element_value, feed_refresh_hints& refresh_hints)
+{
+	static const std::vector<std::string> 
+	day_names = {"sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday"};
+
+	std::string 
+	value = element_value;
+
+	const auto value_begin = value.find_first_not_of(" \t\r\n");
+	const auto value_end = value.find_last_not_of(" \t\r\n");
+
+	value = (value_begin == std::string::npos) ? "" : value.substr(value_begin, value_end - value_begin + 1);
+
+	std::transform(value.begin(), value.end(), value.begin(), switch_letter_case);
+
+	const bool is_number = 
+	(!value.empty() && value.size() < 7 && value.find_first_not_of("0123456789") == std::string::npos);
+
+	if(element_name == element_ttl && is_number)
+	{
+		refresh_hints.ttl_minutes = std::stoi(value);
+	}
+	else if(element_name == element_hour && is_number && std::stoi(value) < 24)
+	{
+		refresh_hints.skip_hours |= (1 << std::stoi(value));
+	}
+	else if(element_name == element_day)
+	{
+		const auto day_name = std::find(day_names.cbegin(), day_names.cend(), value);
+
+		if(day_name != day_names.cend())
+		{
+			refresh_hints.skip_days |= (1 << (day_name - day_names.cbegin()));
+		}
+	}
+
+	return;
+}
+
+//The goal of the following operations is to produce a data structure of type std::map<std::string, std::vector<std::map<std::string, std::string>>>.
+//Manage access to a database that contains the data used to form the data structure.
+
+//SQL: Database infrastructure/tables.
+
+//The following functions under this section deals with supporting database structures for the rss engine.
+
+//Governs the deallocation of an sqlite3 pointer through a pointer resource handle.
+static void 
+db_connection_guard_finalize(sqlite3* obj)
+{
+	if(obj)
+	{
+		db_release_statements(obj);
+
+		sqlite3_close(obj);
+	}
+
+	return;
+}
+
+//Returns a leased connection to the pool for the next caller.
+//Used as the deleter of the connection guards in the public functions.
+static void 
+db_connection_guard_release(sqlite3* obj)
+{
+	if(obj)
+	{
+		std::lock_guard<std::mutex> pool_guard(_db_connection_pool.lock);
+
+		_db_connection_pool.idle_connections.push_back(obj);
+	}
+
+	return;
+}
+
+//Leases an open connection from the pool, opening a new one if none are idle.
+//The first connection opened also confirms the tables, so that check runs once per process.
+//db_connection is left as nullptr if the database cannot be opened.
+static bool 
+db_lease_connection(sqlite3** db_connection)
+{
+	bool success = false;
+
+	std::lock_guard<std::mutex> pool_guard(_db_connection_pool.lock);
+
+	if(!_db_connection_pool.idle_connections.empty())
+	{
+		*db_connection = _db_connection_pool.idle_connections.back();
+
+		_db_connection_pool.idle_connections.pop_back();
+
+		success = true;
+	}
+	else
+	{
+		success = db_check_database_exist(db_connection);
+
+		if(success && !_db_connection_pool.tables_exist)
+		{
+			_db_connection_pool.tables_exist = 
+			db_check_tables_exist(db_connection) && db_migrate_schema(db_connection);
+
+			_db_connection_pool.search_available = 
+			_db_connection_pool.tables_exist && db_prepare_search_index(db_connection);
+		}
+	}
+
+	return success;
+}
+
+//Closes the connections that are not leased.
+//Leased connections return to the pool as usual and are closed on the next call or at exit.
+static void 
+db_close_idle_connections()
+{
+	std::vector<sqlite3*> idle_connections;
+
+	{
+		std::lock_guard<std::mutex> pool_guard(_db_connection_pool.lock);
+
+		idle_connections.swap(_db_connection_pool.idle_connections);
+
+		//Checked again by the next connection, in case the database file was replaced.
+		_db_connection_pool.tables_exist = false;
+	}
+
+	for(sqlite3* idle_connection : idle_connections)
+	{
+		db_connection_guard_finalize(idle_connection);
+	}
+
+	return;
+}
+
+db_connection_pool::~db_connection_pool()
+{
+	for(sqlite3* idle_connection : idle_connections)
+	{
+		db_connection_guard_finalize(idle_connection);
+	}
+
+	return;
+}
+
+//Make a database file if one does not exist.
+//Not currently a halting error if this fails. 
+//Rather, the process fails silently if a database cannot be made available.
+//Each connection gets a private page cache that stays warm while it sits in the pool.
+static bool 
+db_check_database_exist(sqlite3** db_connection)
+{
+	bool success = false;
+
+	auto sqlite_options = (SQLITE_OPEN_PRIVATECACHE | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+	const auto open_result = 
+	sqlite3_open_v2(_db_connection_pool.storage_settings.database_file_name.data(), db_connection, sqlite_options, nullptr);
+
+	if(open_result == SQLITE_OK && *db_connection)
+	{
+		//Pooled connections can be used by more than one thread at a time.
+		//Wait on a locked database rather than fail immediately.
+		sqlite3_busy_timeout(*db_connection, _db_busy_timeout_milliseconds);
+
+		//Used by the schema migrations, which run on the first connection opened.
+		sqlite3_create_function(*db_connection, "feed_date_epoch", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, db_feed_date_epoch, nullptr, nullptr);
+
+		db_apply_storage_settings(db_connection);
+
+		success = true;
+	}
+	else
+	{
+		std::cout 
+		<< "unable to open database.\n";
+
+		//A handle is returned even on failure and has to be closed.
+		sqlite3_close(*db_connection);
+
+		*db_connection = nullptr;
+	}
+
+	return success;
+}
+
+//Examines the database for the existence of tables.
+//Uses an aggregate function to determine if a table exists.
+//If the table does not exist, dispatches a call to db_create_table, to define the table in the database.
+static bool 
+db_check_tables_exist(sqlite3** db_connection)
+{
+	bool success = false;
+
+	if(db_connection)
+	{
+		const auto expected = _table_names.size();
+
+		decltype(_table_names)::size_type actual = 0;
+
+		for(const std::string& table_name : _table_names)
+		{
+			std::string 
+			sql_text = 
+			"SELECT \
+			 	COUNT(*) AS row_count \
+			FROM sqlite_master \
+			WHERE type='table' \
+			  AND name = @table_name; \
+			";
+
+			std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+			{
+				create_binding("@table_name", table_name, parameter_data_type::text)
+			};
+
+			sqlite3_int64 row_count = -1;
+
+			apply_sql(db_connection, sql_text, parameter_values, [&row_count](sqlite3_stmt* sql_stmt)
+			{
+				row_count = sqlite3_column_int64(sql_stmt, 0);
+			});
+
+			if(row_count >= 0)
+			{
+				const bool exists = (row_count > 0);
+
+				if(exists)
+				{
+					actual++;//note the existence of the table.
+				}
+				else//not exists
+				{
+					const bool table_created = 
+					db_create_table(db_connection, table_name);
+
+					if(table_created)
+					{
+						actual++;//note its existence.
+					}
+				}
+			}
+		}
+
+		success = (actual == expected);
+	}
+
+	return success;
+}
+
+//Defines tables in the relational database used by the rss engine.
+static bool 
+db_create_table(sqlite3** db_connection, const std::string& table_name)
+{
+	bool success = false;
+
+	if(db_connection)
+	{
+		std::string db_create_table_statement_text = "";
+
+		if(table_name == "rss_feed_source")
+		{
+			db_create_table_statement_text = 
+			"CREATE TABLE " + table_name + "\
+			(\
+				id INTEGER PRIMARY KEY ASC,\
+				type_code INTEGER DEFAULT 1,\
+				entry_date TEXT DEFAULT (datetime(CURRENT_TIMESTAMP, 'localtime')),\
+				name TEXT NOT NULL COLLATE NOCASE,\
+				url TEXT NOT NULL COLLATE NOCASE\
+			 );\
+			 ";
+		}
+		else if(table_name == "rss_feed_data" || table_name == "rss_feed_data_staging")
+		{
+			db_create_table_statement_text = 
+			"CREATE TABLE " + table_name + "\
+			(\
+				id INTEGER PRIMARY KEY ASC,\
+				rss_feed_source_id INTEGER NOT NULL,\
+				entry_date TEXT DEFAULT (datetime(CURRENT_TIMESTAMP, 'localtime')),\
+				pub_date TEXT NOT NULL,\
+				title TEXT NOT NULL COLLATE NOCASE,\
+				link TEXT NOT NULL COLLATE NOCASE,\
+				description TEXT NOT NULL COLLATE NOCASE\
+			 );\
+			 ";
+		}
+
+		if(!db_create_table_statement_text.empty())
+		{
+			char* error_message = 0;
+
+			const auto sqlite_result = 
+			sqlite3_exec(*db_connection, db_create_table_statement_text.data(), nullptr, nullptr, &error_message);
+
+			if(sqlite_result == SQLITE_OK)
+			{
+				success = true;
+			}
+			else
+			{
+				output_op_sql_error_message(&error_message, __LINE__);
+			}
+		}
+	}
+
+	return success;
+}
+
+//Sets the connection pragmas from the storage settings.
+//Called with the pool lock held, from db_lease_connection.
+//Pragmas do not take parameters, so text settings are checked against their allowed values first.
+static void 
+db_apply_storage_settings(sqlite3** db_connection)
+{
+	const gautier::rss_model::unit_type_storage_settings& storage_settings = 
+	_db_connection_pool.storage_settings;
+
+	std::string sql_text = "";
+
+	if(storage_settings.write_ahead_log)
+	{
+		sql_text += "PRAGMA journal_mode = WAL;";
+	}
+
+	auto is_allowed = [](const std::string& setting_value, const std::vector<std::string>& allowed_values) -> bool
+	{
+		std::string 
+		lower_value = setting_value;
+
+		std::transform(lower_value.begin(), lower_value.end(), lower_value.begin(), switch_letter_case);
+
+		return std::find(allowed_values.cbegin(), allowed_values.cend(), lower_value) != allowed_values.cend();
+	};
+
+	if(is_allowed(storage_settings.synchronous, {"off", "normal", "full", "extra"}))
+	{
+		sql_text += "PRAGMA synchronous = " + storage_settings.synchronous + ";";
+	}
+	else
+	{
+		std::cout 
+		<< "synchronous setting " << storage_settings.synchronous 
+		<< " not recognized.\n";
+	}
+
+	if(is_allowed(storage_settings.temp_store, {"default", "file", "memory"}))
+	{
+		sql_text += "PRAGMA temp_store = " + storage_settings.temp_store + ";";
+	}
+	else
+	{
+		std::cout 
+		<< "temp_store setting " << storage_settings.temp_store 
+		<< " not recognized.\n";
+	}
+
+	sql_text += "PRAGMA cache_size = " + std::to_string(storage_settings.cache_size) + ";";
+	sql_text += "PRAGMA mmap_size = " + std::to_string(storage_settings.mmap_size) + ";";
+
+	char* error_message = 0;
+
+	const auto sqlite_result = 
+	sqlite3_exec(*db_connection, sql_text.data(), nullptr, nullptr, &error_message);
+
+	if(sqlite_result != SQLITE_OK)
+	{
+		output_op_sql_error_message(&error_message, __LINE__);
+	}
+
+	return;
+}
+
+//SQL function feed_date_epoch(text). Seconds since the epoch of a feed item publication date, or 0 when it cannot be read.
+static void 
+db_feed_date_epoch(sqlite3_context* sql_context, int argument_count, sqlite3_value** argument_values)
+{
+	long long seconds_since_epoch = 0;
+
+	const char* date_text = 
+	(argument_count > 0) ? reinterpret_cast<const char*>(sqlite3_value_text(argument_values[0])) : nullptr;
+
+	if(date_text)
+	{
+		parse_feed_date(std::string(date_text, static_cast<std::string::size_type>(sqlite3_value_bytes(argument_values[0]))), seconds_since_epoch);
+	}
+
+	sqlite3_result_int64(sql_context, seconds_since_epoch);
+
+	return;
+}
+
+//Brings the tables up to the latest schema version.
+//Each step runs in its own transaction and records its version when it commits,
+//	so an interrupted upgrade resumes from the last completed step.
+static bool 
+db_migrate_schema(sqlite3** db_connection)
+{
+	bool success = true;
+
+	int schema_version = 0;
+
+	{
+		std::string 
+		sql_text = "PRAGMA user_version;";
+
+		apply_sql(db_connection, sql_text, _empty_param_set, [&schema_version](sqlite3_stmt* sql_stmt)
+		{
+			schema_version = sqlite3_column_int(sql_stmt, 0);
+		});
+	}
+
+	for(auto migration_n = static_cast<type_list_size>(schema_version); success && migration_n < _schema_migrations.size(); migration_n++)
+	{
+		const std::string 
+		sql_text = 
+		"BEGIN IMMEDIATE TRANSACTION;" 
+		+ _schema_migrations[migration_n] 
+		+ "PRAGMA user_version = " + std::to_string(migration_n + 1) + ";" 
+		+ "COMMIT TRANSACTION;";
+
+		char* error_message = 0;
+
+		const auto sqlite_result = 
+		sqlite3_exec(*db_connection, sql_text.data(), nullptr, nullptr, &error_message);
+
+		if(sqlite_result != SQLITE_OK)
+		{
+			success = false;
+
+			output_op_sql_error_message(&error_message, __LINE__);
+
+			if(!sqlite3_get_autocommit(*db_connection))
+			{
+				sqlite3_exec(*db_connection, "ROLLBACK TRANSACTION;", nullptr, nullptr, nullptr);
+			}
+		}
+	}
+
+	return success;
+}
+
+//Makes the full text index for search_feed_items when SQLite has FTS5, and fills it from the saved feed items.
+//Kept out of the schema versions so a build without FTS5 still brings the rest of the schema up to date.
+//The index is in step with rss_feed_data while all of its triggers exist. It is filled again when any is missing.
+//Without FTS5 the triggers are dropped, since saving feed items would fail on them.
+//Returns true when search is available.
+static bool 
+db_prepare_search_index(sqlite3** db_connection)
+{
+	bool fts5_available = false;
+
+	{
+		std::string 
+		sql_text = "SELECT sqlite_compileoption_used('ENABLE_FTS5');";
+
+		apply_sql(db_connection, sql_text, _empty_param_set, [&fts5_available](sqlite3_stmt* sql_stmt)
+		{
+			fts5_available = (sqlite3_column_int(sql_stmt, 0) != 0);
+		});
+	}
+
+	type_list_size trigger_count = 0;
+
+	for(const std::string& trigger_name : _search_trigger_names)
+	{
+		std::string 
+		sql_text = "SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND name = @trigger_name;";
+
+		std::vector<std::tuple<std::string, std::string, parameter_data_type>> parameter_values = 
+		{
+			create_binding("@trigger_name", trigger_name, parameter_data_type::text)
+		};
+
+		apply_sql(db_connection, sql_text, parameter_values, [&trigger_count](sqlite3_stmt* sql_stmt)
+		{
+			trigger_count += (sqlite3_column_int(sql_stmt, 0) > 0) ? 1 : 0;
+		});
+	}
+
+	std::string 
+	sql_text{};
+
+	if(fts5_available && trigger_count < _search_trigger_names.size())
+	{
+		for(const std::string& statement_text : _search_index_statements)
+		{
+			sql_text += statement_text;
+		}
+	}
+	else if(!fts5_available && trigger_count > 0)
+	{
+		for(const std::string& trigger_name : _search_trigger_names)
+		{
+			sql_text += "DROP TRIGGER IF EXISTS " + trigger_name + ";";
+		}
+	}
+
+	bool success = fts5_available;
+
+	if(!sql_text.empty())
+	{
+		sql_text = "BEGIN IMMEDIATE TRANSACTION;" + sql_text + "COMMIT TRANSACTION;";
+
+		char* error_message = 0;
+
+		const auto sqlite_result = 
+		sqlite3_exec(*db_connection, sql_text.data(), nullptr, nullptr, &error_message);
+
+		if(sqlite_result != SQLITE_OK)
+		{
+			success = false;
+
+			output_op_sql_error_message(&error_message, __LINE__);
+
+			if(!sqlite3_get_autocommit(*db_connection))
+			{
+				sqlite3_exec(*db_connection, "ROLLBACK TRANSACTION;", nullptr, nullptr, nullptr);
+			}
+		}
+	}
+
+	if(!fts5_available)
+	{
+		std::cout << "SQLite was built without FTS5. Feed items cannot be searched.\n";
+	}
+
+	return success;
+}
+
+static bool 
+db_transact_begin(sqlite3** db_connection)
+{
+	static std::string 
+	sql_text = "BEGIN IMMEDIATE TRANSACTION";
+
+	auto sqlite_result = 
+	apply_sql(db_connection, sql_text, _empty_param_set, nullptr);
+
+	return sqlite_result.first;
+}
+
+static bool 
+db_transact_end(sqlite3** db_connection)
+{
+	static std::string 
+	sql_text = "COMMIT TRANSACTION";
+
+	auto sqlite_result = 
+	apply_sql(db_connection, sql_text, _empty_param_set, nullptr);
+
+	return sqlite_result.first;
+}
+
+//SQL: Queries
+
+//Links a named parameter to data value for use in a parameterized sql statement.
+static std::tuple<std::string, std::string, parameter_data_type> 
+create_binding(const std::string name, const std::string value, const parameter_data_type parameter_type)
+{
+	return std::tuple<std::string, std::string, parameter_data_type>(name, value, parameter_type);
+}
+
+//Execute an sql statement.
+//At the same level as the sqlite3_exec function.
+//Introduces parameters to an sql statement and hands each result row to row_reader.
+//The row reader takes the columns it needs by index, in the types it needs,
+//	straight from the statement. No intermediate copy of the row is made.
+//This function will immediately output all error messages to std out rather than return an error data structure.
+//As a result, the return SQLITE result code/error code is primarily for control caller control flow.
+static std::pair<bool, int> 
+apply_sql(sqlite3** db_connection, std::string& sql_text, std::vector<std::tuple<std::string, std::string, parameter_data_type>>& parameter_binding_infos, const type_row_reader& row_reader)
+{
+	bool success = false;
+	int row_count = -1;
+
+	if(!db_connection || sql_text.empty())
+	{
+		return std::pair<bool, int>(success, row_count);
+	}
+
+	//Compiled once per connection. Later calls with the same sql text reuse it.
+	sqlite3_stmt* sql_stmt = 
+	db_get_statement(db_connection, sql_text);
+
+	if(sql_stmt)
+	{
+		int params_count = 0;
+
+		//Binding the input values to the input sql statement.
+		for(auto& bind_info : parameter_binding_infos)
+		{
+			params_count++;
+
+			int param_n = params_count;
+
+			const std::string parameter_name = std::get<0>(bind_info);
+			const std::string parameter_text = std::get<1>(bind_info);
+			const parameter_data_type param_t = std::get<2>(bind_info);
+
+			auto sqlite_result = 0;
+
+			if(param_t == parameter_data_type::text)
+			{
+				const char* param_char_ptr = parameter_text.data();
+				const int param_char_ptr_sz = -1;
+
+				sqlite3_bind_text(sql_stmt, param_n, param_char_ptr, param_char_ptr_sz, SQLITE_TRANSIENT);
+			}
+			else if(param_t == parameter_data_type::integer)
+			{
+				const sqlite3_int64 param_value = std::stoll(parameter_text);
+
+				sqlite3_bind_int64(sql_stmt, param_n, param_value);
+			}
+			else
+			{
+				if(param_t != parameter_data_type::none)
+				{
+					std::cout 
+					<< "parameter " << parameter_name 
+					<< " data type not mapped.\n";
+				}
+			}
+
+			if(sqlite_result != SQLITE_OK)
+			{
+				output_op_sql_error_message(db_connection, __LINE__);
+
+				break;
+			}
+		}
+
+		if(static_cast<type_list_size>(params_count) != parameter_binding_infos.size())
+		{
+			success = false;
+
+			std::cout 
+			<< "could not bind params to: " << sql_text 
+			<< "\n";
+
+			std::cout 
+			<< "total parameters : " << parameter_binding_infos.size() 
+			<< "\n";
+
+			for(auto& diag_bind_info : parameter_binding_infos)
+			{
+				std::cout 
+				<< std::get<0>(diag_bind_info) << " | " 
+				<< std::get<1>(diag_bind_info) << " | " 
+				<< std::to_string(static_cast<type_list_size>(std::get<2>(diag_bind_info))) 
+				<< "\n";
+			}
+		}
+		else
+		{
+			//Run the SQL.
+			auto sqlite_result = SQLITE_BUSY;
+
+			if(!sqlite3_stmt_readonly(sql_stmt))
+			{
+				sqlite_result = 
+				sqlite3_step(sql_stmt);
+			}
+			else
+			{
+				do
+				{
+					sqlite_result = 
+					sqlite3_step(sql_stmt);
+
+					if(sqlite_result == SQLITE_ROW && row_reader)
+					{
+						row_reader(sql_stmt);
+					}
+				}while(sqlite_result == SQLITE_ROW);
+			}
+
+			if(sqlite_result == SQLITE_DONE)
+			{
+				success = true;
+
+				row_count = sqlite3_changes(*db_connection);
+			}
+			else
+			{
+				success = false;//undoing any success up to this point.
+
+				output_op_sql_error_message(db_connection, __LINE__);
+			}
+		}
+	}
+
+	//diagnostic
+	if(_issued_sql_output_enabled)
+	{
+		auto sql_statement_text = sqlite3_sql(sql_stmt);
+
+		std::cout << "\t\t ran " 
+		<< sql_statement_text;
+
+		if(success)
+		{
+			std::cout 
+			<< ". the result was good. " ;
+
+			if(_rows_affected_output_enabled)
+			{
+				std::cout << row_count << " rows affected. ";
+			}
+		}
+		else
+		{
+			std::cout << ". failed. ";
+		}
+
+		std::cout << "\n";
+	}
+	else
+	{
+		if(_rows_affected_output_enabled)
+		{
+			std::cout 
+			<< row_count
+			<< " rows affected.\n";
+		}
+	}
+
+	if(sql_stmt)
+	{
+		//The statement stays in the cache. Reset it and drop the bound values for the next caller.
+		//Any step error was already reported above. sqlite3_reset repeats that error code.
+		sqlite3_reset(sql_stmt);
+		sqlite3_clear_bindings(sql_stmt);
+	}
+
+	return std::pair<bool, int>(success, row_count);
+}
+
+//Returns the prepared statement for the sql text on this connection.
+//Compiles and caches it on first use. Returns nullptr if the sql does not compile.
+//Only the first statement in sql_text is compiled, the same as sqlite3_prepare_v2.
+static sqlite3_stmt* 
+db_get_statement(sqlite3** db_connection, const std::string& sql_text)
+{
+	sqlite3_stmt* sql_stmt = nullptr;
+
+	{
+		std::lock_guard<std::mutex> cache_guard(_db_statement_cache_lock);
+
+		auto& connection_statements = _db_statement_cache[*db_connection];
+
+		const auto cached = connection_statements.find(sql_text);
+
+		if(cached != connection_statements.end())
+		{
+			sql_stmt = cached->second;
+		}
+	}
+
+	if(!sql_stmt)
+	{
+		const auto sqlite_prepare_result = 
+		sqlite3_prepare_v3(*db_connection, sql_text.data(), -1, SQLITE_PREPARE_PERSISTENT, &sql_stmt, nullptr);
+
+		if(sqlite_prepare_result == SQLITE_OK && sql_stmt)
+		{
+			std::lock_guard<std::mutex> cache_guard(_db_statement_cache_lock);
+
+			_db_statement_cache[*db_connection][sql_text] = sql_stmt;
+		}
+		else
+		{
+			output_op_sql_error_message(db_connection, __LINE__);
+
+			sql_stmt = nullptr;
+		}
+	}
+
+	return sql_stmt;
+}
+
+//Finalizes every cached statement for a connection so the connection can close.
+static void 
+db_release_statements(sqlite3* db_connection)
+{
+	std::lock_guard<std::mutex> cache_guard(_db_statement_cache_lock);
+
+	const auto connection_statements = _db_statement_cache.find(db_connection);
+
+	if(connection_statements != _db_statement_cache.end())
+	{
+		for(auto& cached : connection_statements->second)
+		{
+			sqlite3_finalize(cached.second);
+		}
+
+		_db_statement_cache.erase(connection_statements);
+	}
+
+	return;
+}
+
+//Copies a text column into value without an intermediate string.
+//A NULL column produces an empty value.
+static void 
+get_column_text(sqlite3_stmt* sql_stmt, const int column_index, std::string& value)
+{
+	const unsigned char* column_text = 
+	sqlite3_column_text(sql_stmt, column_index);
+
+	if(column_text)
+	{
+		value.assign(reinterpret_cast<const char*>(column_text), static_cast<std::string::size_type>(sqlite3_column_bytes(sql_stmt, column_index)));
 	}
 	else
 	{
-		output_op_sql_error_message(db_connection, __LINE__);
+		value.clear();
+	}
+
+	return;
+}
+
+//SQL: Diagnostics
+
+//Diagnostics support for SQLite3.
+//----------------------------------------------------------
+//The following functions are used for debugging, profiling use of SQLite3.
+static void 
+enable_op_sql_trace(sqlite3** db_connection)
+{
+	if(_sql_trace_enabled && !_sql_trace_active)
+	{
+		sqlite3_trace(*db_connection, trace_sql_op, nullptr);
+
+		_sql_trace_active = true;
+	}
+
+	return;
+}
+
+static void 
+trace_sql_op(void* in1, const char* in2)
+{
+	if(_sql_trace_active)
+	{
+		if(in1)
+		{
+			std::cout << " ";
+		}
+
+		std::cout << in2 << "\n";
+	}
+
+	return;
+}
+
+static void 
+enable_op_sql_autolog()
+{
+	if(_sql_trace_enabled)
+	{
+		sqlite3_config(SQLITE_CONFIG_LOG, log_sql_op_event, nullptr);
+	}
+
+	return;
+}
+
+void 
+log_sql_op_event(void *pArg, int iErrCode, const char *zMsg)
+{
+	if(_sql_trace_enabled && _sql_trace_active)
+	{
+		if(pArg)
+		{
+			std::cout << __FILE__ << "(" << __LINE__ << ") ";
+		}
+
+		std::cout 
+		<< iErrCode << " " 
+		<< zMsg;
+	}
+
+	return;
+}
+
+static void 
+output_op_sql_error_message(sqlite3** db_connection, const int& line_number)
+{
+	std::cout 
+	<< sqlite3_errmsg(*db_connection) << " " 
+	<< line_number 
+	<< "\n";
+
+	return;
+}
+
+static void 
+output_op_sql_error_message(char** error_message, const int& line_number)
+{
+	std::cout 
+	<< *error_message << " " 
+	<< line_number 
+	<< "\n";
+
+	sqlite3_free(*error_message);
+
+	*error_message = nullptr;
+
+	return;
+}
+
+//Support functions.
+static int 
+switch_letter_case (const char& in_char)
+{
+	return std::tolower(in_char);
+}
+
+//Extracts the host portion of a web address, in lower case.
+//Used to group feed sources that share a network when limiting requests.
+static std::string 
+get_url_host(const std::string& url)
+{
+	auto host_begin = url.find("://");
+
+	host_begin = (host_begin == std::string::npos) ? 0 : host_begin + 3;
+
+	const auto host_end = url.find_first_of(":/?#", host_begin);
+
+	std::string 
+	host = url.substr(host_begin, host_end - host_begin);
+
+	std::transform(host.begin(), host.end(), host.begin(), switch_letter_case);
+
+	return host;
+}
+
+//Reads the publication date of a feed item as seconds since the epoch.
+//RSS 2.0 dates are RFC 822. RSS 1.0 and Atom dates are RFC 3339, which is tried first as it is rejected sooner.
+//seconds_since_epoch is unchanged when neither form matches.
+static bool 
+parse_feed_date(const std::string& date_text, long long& seconds_since_epoch)
+{
+	return parse_rfc3339_date(date_text, seconds_since_epoch) || parse_rfc822_date(date_text, seconds_since_epoch);
+}
+
+//Reads dates in the RFC 822 form used by RSS, such as "Tue, 10 Jun 2003 04:00:00 GMT".
+//The day name and seconds are optional. Years of two digits are taken as 19xx or 20xx as RFC 2822 does.
+//Time zones may be numeric, UT, GMT, Z or a North American zone name. Other zone names are taken as GMT.
+static bool 
+parse_rfc822_date(const std::string& date_text, long long& seconds_since_epoch)
+{
+	static const std::vector<std::string> 
+	month_names = {"jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"};
+
+	static const std::map<std::string, int> 
+	zone_offset_hours = {{"est", -5}, {"edt", -4}, {"cst", -6}, {"cdt", -5}, {"mst", -7}, {"mdt", -6}, {"pst", -8}, {"pdt", -7}};
+
+	std::string 
+	date_value = date_text;
+
+	std::replace(date_value.begin(), date_value.end(), ',', ' ');
+	std::transform(date_value.begin(), date_value.end(), date_value.begin(), switch_letter_case);
+
+	std::istringstream date_parts(date_value);
+
+	std::vector<std::string> parts;
+
+	for(std::string part; date_parts >> part;)
+	{
+		parts.push_back(part);
+	}
+
+	//The day name, if present, is the only part that does not start with a digit before the month.
+	if(!parts.empty() && !std::isdigit(static_cast<unsigned char>(parts.front().front())))
+	{
+		parts.erase(parts.begin());
+	}
+
+	if(parts.size() < 4)
+	{
+		return false;
+	}
+
+	const auto month_name = std::find(month_names.cbegin(), month_names.cend(), parts[1].substr(0, 3));
+
+	const std::string& day_text = parts[0];
+	const std::string& year_text = parts[2];
+	const std::string& time_text = parts[3];
+
+	//The time is only digits and colons, so a sign is not read as part of hours, minutes or seconds.
+	if(month_name == month_names.cend() 
+	|| day_text.size() > 2 || day_text.find_first_not_of("0123456789") != std::string::npos 
+	|| year_text.size() > 4 || year_text.find_first_not_of("0123456789") != std::string::npos 
+	|| time_text.find_first_not_of("0123456789:") != std::string::npos)
+	{
+		return false;
+	}
+
+	int 
+		hours = 0,
+		minutes = 0,
+		seconds = 0
+	;
+
+	char time_separator_1 = 0, time_separator_2 = 0;
+
+	std::istringstream time_parts(time_text);
+
+	time_parts >> hours >> time_separator_1 >> minutes;
+
+	if(!time_parts || time_separator_1 != ':')
+	{
+		return false;
+	}
+
+	if(time_parts >> time_separator_2 && time_separator_2 == ':')
+	{
+		time_parts >> seconds;
+	}
+
+	long long year = std::stoll(year_text);
+
+	if(year_text.size() <= 2)
+	{
+		year += (year < 50) ? 2000 : 1900;
+	}
+
+	const unsigned month = static_cast<unsigned>(month_name - month_names.cbegin()) + 1;
+	const unsigned day = static_cast<unsigned>(std::stoi(day_text));
+
+	if(day < 1 || day > 31 || hours > 23 || minutes > 59 || seconds > 60)
+	{
+		return false;
+	}
+
+	long long zone_offset_seconds = 0;
+
+	if(parts.size() > 4)
+	{
+		const std::string& zone = parts[4];
+
+		if((zone.front() == '+' || zone.front() == '-') && zone.size() == 5 && zone.find_first_not_of("0123456789", 1) == std::string::npos)
+		{
+			zone_offset_seconds = (std::stoll(zone.substr(1, 2)) * 3600 + std::stoll(zone.substr(3, 2)) * 60) * ((zone.front() == '-') ? -1 : 1);
+		}
+		else
+		{
+			const auto zone_offset = zone_offset_hours.find(zone);
+
+			if(zone_offset != zone_offset_hours.cend())
+			{
+				zone_offset_seconds = zone_offset->second * 3600;
+			}
+		}
+	}
+
+	seconds_since_epoch = 
+	get_days_from_civil(year, month, day) * 86400 + hours * 3600 + minutes * 60 + seconds - zone_offset_seconds;
+
+	return true;
+}
+
+//Days since 1970-01-01 of a proleptic Gregorian calendar date.
+//Does not depend on the local time zone, unlike mktime.
+static long long 
+get_days_from_civil(long long year, const unsigned month, const unsigned day)
+{
+	year -= (month <= 2) ? 1 : 0;
+
+	const long long era = (year >= 0 ? year : year - 399) / 400;
+	const long long year_of_era = year - era * 400;
+	const long long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	const long long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+	return era * 146097 + day_of_era - 719468;
+}
+
+//Reads dates in the RFC 3339 form used by Atom and Dublin Core, such as "2003-12-13T18:30:02.25+01:00".
+//The time, seconds, fraction of a second and zone are optional, as W3C dates allow. No zone is taken as UTC.
+//A space may stand in for the T. The fraction of a second is dropped.
+static bool 
+parse_rfc3339_date(const std::string& date_text, long long& seconds_since_epoch)
+{
+	const auto text_begin = date_text.find_first_not_of(" \t\r\n");
+	const auto text_end = date_text.find_last_not_of(" \t\r\n") + 1;
+
+	if(text_begin == std::string::npos)
+	{
+		return false;
+	}
+
+	//Character at a position, or 0 past the end of the date.
+	const auto get_char = [&date_text, text_end](const std::string::size_type position) -> char
+	{
+		return (position < text_end) ? date_text[position] : 0;
+	};
+
+	//Reads digit_count digits starting at a position.
+	const auto read_number = [&get_char](const std::string::size_type position, const int digit_count, int& value) -> bool
+	{
+		value = 0;
+
+		for(int digit_n = 0; digit_n < digit_count; digit_n++)
+		{
+			const char digit = get_char(position + digit_n);
+
+			if(digit < '0' || digit > '9')
+			{
+				return false;
+			}
+
+			value = value * 10 + (digit - '0');
+		}
+
+		return true;
+	};
+
+	int 
+		year = 0,
+		month = 0,
+		day = 0,
+		hours = 0,
+		minutes = 0,
+		seconds = 0
+	;
+
+	auto position = text_begin;
+
+	if(!read_number(position, 4, year) || get_char(position + 4) != '-' 
+	|| !read_number(position + 5, 2, month) || get_char(position + 7) != '-' 
+	|| !read_number(position + 8, 2, day))
+	{
+		return false;
 	}
 
-	//diagnostic
-	if(_issued_sql_output_enabled)
-	{
-		auto sql_statement_text = sqlite3_sql(sql_stmt);
+	position += 10;
 
-		std::cout << "\t\t ran " 
-		<< sql_statement_text;
+	long long zone_offset_seconds = 0;
 
-		if(success)
+	const char time_separator = get_char(position);
+
+	if(time_separator == 'T' || time_separator == 't' || time_separator == ' ')
+	{
+		if(!read_number(position + 1, 2, hours) || get_char(position + 3) != ':' || !read_number(position + 4, 2, minutes))
 		{
-			std::cout 
-			<< ". the result was good. " ;
+			return false;
+		}
 
-			if(_rows_affected_output_enabled)
+		position += 6;
+
+		if(get_char(position) == ':')
+		{
+			if(!read_number(position + 1, 2, seconds))
 			{
-				std::cout << row_count << " rows affected. ";
+				return false;
 			}
+
+			position += 3;
 		}
-		else
+
+		if(get_char(position) == '.')
 		{
-			std::cout << ". failed. ";
+			do
+			{
+				position++;
+			}
+			while(std::isdigit(static_cast<unsigned char>(get_char(position))));
 		}
 
-		std::cout << "\n";
-	}
-	else
-	{
-		if(_rows_affected_output_enabled)
+		const char zone_sign = get_char(position);
+
+		if(zone_sign == 'Z' || zone_sign == 'z')
 		{
-			std::cout 
-			<< row_count
-			<< " rows affected.\n";
+			position++;
 		}
-	}
-
-	if(sql_stmt)
-	{
-		sqlite3_reset(sql_stmt);//clean it up so finalize can succeed.
+		else if(zone_sign == '+' || zone_sign == '-')
+		{
+			int 
+				zone_hours = 0,
+				zone_minutes = 0
+			;
 
-		const auto sqlite_result = 
-		sqlite3_finalize(sql_stmt);
+			if(!read_number(position + 1, 2, zone_hours) || get_char(position + 3) != ':' || !read_number(position + 4, 2, zone_minutes))
+			{
+				return false;
+			}
 
-		if(sqlite_result != SQLITE_OK)
-		{
-			success = false;
+			zone_offset_seconds = (zone_hours * 3600 + zone_minutes * 60) * ((zone_sign == '-') ? -1 : 1);
 
-			output_op_sql_error_message(db_connection, __LINE__);
+			position += 6;
 		}
 	}
 
-	return std::pair<bool, int>(success, row_count);
+	if(position != text_end || month < 1 || month > 12 || day < 1 || day > 31 || hours > 23 || minutes > 59 || seconds > 60)
+	{
+		return false;
+	}
+
+	seconds_since_epoch = 
+	get_days_from_civil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * 86400 + hours * 3600 + minutes * 60 + seconds - zone_offset_seconds;
+
+	return true;
 }
 
-//Converts the columns in an sqlite3_stmt structure to query_value rows;
 static bool 
-translate_sql_result(std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values, sqlite3_stmt* sql_stmt)
+is_network_location(const std::string& feed_url)
 {
-	bool success = false;
+	std::string 
+	scheme = feed_url.substr(0, feed_url.find("://"));
 
-	if(query_values)
-	{
-		std::map<std::string, std::string> 
-		row_of_data;
+	std::transform(scheme.begin(), scheme.end(), scheme.begin(), switch_letter_case);
 
-		type_list_size total_columns = 0L;
-		{
-			using n_unit = int;
+	return (scheme == "http" || scheme == "https");
+}
 
-			const n_unit max_columns = sqlite3_column_count(sql_stmt);
+//Runs the transfer until more of the body is received or the transfer ends.
+//A stop requested by the caller of collect_feeds ends the transfer within one wait, as CURLE_ABORTED_BY_CALLBACK.
+//Returns false once the transfer has ended and everything received has been read.
+static bool 
+feed_download_advance(feed_download& download)
+{
+	const auto advance_start = std::chrono::steady_clock::now();
 
-			for(n_unit col_n = 0; col_n < max_columns; col_n++)
-			{
-				const std::string 
-				column_name = sqlite3_column_name(sql_stmt, col_n);
+	while(!download.finished && download.received_offset == download.received.size())
+	{
+		int running_count = 0;
 
-				std::stringstream ostr;
-				ostr << sqlite3_column_text(sql_stmt, col_n);
+		CURLMcode driver_result = 
+		curl_multi_perform(download.transfer_driver, &running_count);
 
-				row_of_data[column_name] = ostr.str();
-			}
+		if(driver_result == CURLM_OK && running_count > 0 && download.received_offset == download.received.size())
+		{
+			driver_result = 
+			curl_multi_poll(download.transfer_driver, nullptr, 0, _fetch_wait_milliseconds, nullptr);
+		}
 
-			total_columns = static_cast<type_list_size>(max_columns);
+		if(driver_result != CURLM_OK)
+		{
+			download.finished = true;
+			download.result = CURLE_RECV_ERROR;
 		}
+		else if(running_count == 0)
+		{
+			download.finished = true;
 
-		success = 
-		(total_columns == row_of_data.size());
+			int message_count = 0;
 
-		if(success)
-		{
-			query_values->push_back(row_of_data);
+			while(CURLMsg* message = curl_multi_info_read(download.transfer_driver, &message_count))
+			{
+				if(message->msg == CURLMSG_DONE)
+				{
+					download.result = message->data.result;
+				}
+			}
 		}
-		else
+		//A transfer that has already ended is kept.
+		else if(is_stop_requested(download.stop_requested))
 		{
-			std::cout << "requested " 
-			<< total_columns << " columns " 
-			<< "processed only " << row_of_data.size()
-			<< ".\n";
+			download.finished = true;
+			download.result = CURLE_ABORTED_BY_CALLBACK;
 		}
 	}
 
-	return success;
+	download.network_time += std::chrono::steady_clock::now() - advance_start;
+
+	return (download.received_offset < download.received.size());
 }
 
-//Callback function for sqlite3_exec.
-//Defined to build a data structure, std::vector<std::map<std::string, std::string>> that represents a tabular result set.
-//This result set can be traversed to calling process that issued the sql statement used to generate it.
-static int 
-translate_sql_result(void* user_defined_data, int column_count, char** column_values, char** column_names)
+static std::size_t 
+feed_download_write(char* data, std::size_t size, std::size_t count, void* context)
 {
-	std::vector<std::map<std::string, std::string>>* query_values = nullptr;
+	feed_download& download = *static_cast<feed_download*>(context);
 
-	if(user_defined_data)
+	const std::size_t data_size = size * count;
+
+	download.bytes_received += data_size;
+
+	if(download.content_coding == coding_identity)
+	{
+		download.received.append(data, data_size);
+	}
+	else if(download.content_coding == coding_unsupported || !feed_download_decode(download, data, data_size))
 	{
-		query_values = static_cast<std::vector<std::map<std::string, std::string>>*>(user_defined_data);
+		//Ends the transfer with CURLE_WRITE_ERROR.
+		return 0;
 	}
 
-	std::map<std::string, std::string> 
-	row_of_data;//This is the actual row of data.
+	return data_size;
+}
+
+//Keeps the ETag and Last-Modified values of the final response.
+//Values from redirect responses are dropped when the next status line arrives.
+static std::size_t 
+feed_download_header(char* data, std::size_t size, std::size_t count, void* context)
+{
+	feed_download& download = *static_cast<feed_download*>(context);
+
+	const std::size_t data_size = size * count;
 
-	using n_unit = decltype(column_count);
+	const std::string header_line(data, data_size);
 
-	//every column for the row should be accessible from here.
-	//transfer each column to a corresponding column in the row_of_data variable.
-	for(n_unit column_index = 0; column_index < column_count; column_index++)
+	const auto name_end = header_line.find(':');
+
+	if(header_line.compare(0, 5, "HTTP/") == 0)
+	{
+		download.etag.clear();
+		download.last_modified.clear();
+		download.content_encoding.clear();
+		download.content_coding = coding_identity;
+	}
+	else if(name_end != std::string::npos)
 	{
-		const char* column_name_chars = column_names[column_index];
-		const char* column_value_chars = column_values[column_index];
+		std::string 
+		header_name = header_line.substr(0, name_end);
+
+		std::transform(header_name.begin(), header_name.end(), header_name.begin(), switch_letter_case);
 
-		if(query_values)
+		const auto value_begin = header_line.find_first_not_of(" \t", name_end + 1);
+		const auto value_end = header_line.find_last_not_of(" \t\r\n");
+
+		std::string 
+		header_value = "";
+
+		if(value_begin != std::string::npos && value_end != std::string::npos && value_end >= value_begin)
 		{
-			row_of_data[column_name_chars] = column_value_chars;
+			header_value = header_line.substr(value_begin, value_end - value_begin + 1);
 		}
-		else if(_query_values_translator_output_enabled)
+
+		if(header_name == "etag")
 		{
-			std::cout 
-			<< "column name:" << column_name_chars 
-			<< "| column value:" << column_value_chars 
-			<< "\n";
+			download.etag = header_value;
+		}
+		else if(header_name == "last-modified")
+		{
+			download.last_modified = header_value;
+		}
+		else if(header_name == "content-encoding")
+		{
+			std::transform(header_value.begin(), header_value.end(), header_value.begin(), switch_letter_case);
+
+			download.content_encoding = header_value;
+
+			if(header_value == "gzip" || header_value == "x-gzip" || header_value == "deflate")
+			{
+				download.content_coding = coding_zlib;
+			}
+			else if(header_value == "br")
+			{
+				download.content_coding = coding_brotli;
+			}
+			else if(header_value != "identity")
+			{
+				download.content_coding = coding_unsupported;
+			}
 		}
 	}
 
-	if(query_values)
+	return data_size;
+}
+
+//Input for xmlReaderForIO. Returns 0 at the end of the document and -1 if the transfer failed.
+static int 
+feed_download_read(void* context, char* buffer, int length)
+{
+	feed_download& download = *static_cast<feed_download*>(context);
+
+	int read_length = 0;
+
+	if(length > 0 && feed_download_advance(download))
+	{
+		const auto available = download.received.size() - download.received_offset;
+
+		read_length = static_cast<int>(std::min(available, static_cast<std::string::size_type>(length)));
+
+		download.received.copy(buffer, read_length, download.received_offset);
+		download.received_offset += read_length;
+
+		if(download.received_offset == download.received.size())
+		{
+			download.received.clear();
+			download.received_offset = 0;
+		}
+	}
+	else if(download.result != CURLE_OK)
 	{
-		query_values->push_back(row_of_data);
+		read_length = -1;
 	}
 
+	return read_length;
+}
+
+//The transfer is cleaned up by collect_feed_items_from_network.
+static int 
+feed_download_close(void*)
+{
 	return 0;
 }
 
-//Goes through the query value lines. The value of the 
-//	very first column key name that matches the input is returned.
-static std::string 
-get_first_db_column_value(const std::map<std::string, std::string>& row_of_data, const std::string& col_name)
+//Appends the decoded form of a chunk of a compressed body to download.received.
+//gzip and zlib wrapped deflate are told apart by their headers. Deflate without a zlib header is also accepted,
+//	since some servers send it that way. The decoder is made once the first two bytes have arrived.
+//Returns false if the body cannot be decoded.
+static bool 
+feed_download_decode(feed_download& download, const char* data, const std::size_t data_size)
 {
-	std::string col_value = "";
+	const auto decode_start = std::chrono::steady_clock::now();
 
-	for(auto& column : row_of_data)
+	bool success = true;
+
+	const std::string::size_type received_size = download.received.size();
+
+	unsigned char decoded[16384];
+
+	if(download.content_coding == coding_zlib)
 	{
-		if(column.first == col_name)
+		z_stream& decoder = download.zlib_decoder;
+
+		const char* input = data;
+		std::size_t input_size = data_size;
+
+		//Gathered until the lead has been checked, then decoded from here.
+		std::string lead_input;
+
+		//The first two bytes of the body, or of what follows a gzip member, decide how to go on.
+		//	A chunk may hold a single byte, so they are gathered across chunks.
+		if(!download.decoder_ready || (download.decoder_finished && download.decoder_gzip && !download.decoder_trailer))
 		{
-			col_value = column.second;
+			download.decoder_lead.append(data, data_size);
 
-			break;
+			input_size = 0;
+
+			if(download.decoder_lead.size() > 1)
+			{
+				lead_input.swap(download.decoder_lead);
+
+				const unsigned char* header = reinterpret_cast<const unsigned char*>(lead_input.data());
+
+				const bool is_gzip = (header[0] == 0x1f && header[1] == 0x8b);
+
+				if(!download.decoder_ready)
+				{
+					const bool is_zlib = ((header[0] & 0x0f) == 8 && ((header[0] << 8) | header[1]) % 31 == 0);
+
+					download.decoder_gzip = is_gzip;
+
+					download.decoder_ready = 
+					(inflateInit2(&decoder, (is_gzip || is_zlib) ? (MAX_WBITS + 32) : -MAX_WBITS) == Z_OK);
+
+					success = download.decoder_ready;
+				}
+				else if(is_gzip)
+				{
+					//gzip allows several members one after the other.
+					download.decoder_finished = (inflateReset(&decoder) != Z_OK);
+
+					success = !download.decoder_finished;
+				}
+				else
+				{
+					download.decoder_trailer = true;
+				}
+
+				input = lead_input.data();
+				input_size = lead_input.size();
+			}
 		}
-	}
 
-	return col_value;
-}
+		decoder.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+		decoder.avail_in = static_cast<uInt>(input_size);
 
-//SQL: Diagnostics
+		//Data after the end of a zlib or deflate stream, or after the last gzip member, is ignored.
+		while(success && download.decoder_ready && !download.decoder_finished && (decoder.avail_in > 0 || decoder.avail_out == 0))
+		{
+			decoder.next_out = decoded;
+			decoder.avail_out = sizeof(decoded);
 
-//Diagnostics support for SQLite3.
-//----------------------------------------------------------
-//The following functions are used for debugging, profiling use of SQLite3.
-static void 
-output_data_rows(const std::shared_ptr<std::vector<std::map<std::string, std::string>>> query_values)
-{
-	if(query_values)
+			const int decode_result = inflate(&decoder, Z_NO_FLUSH);
+
+			download.received.append(reinterpret_cast<const char*>(decoded), sizeof(decoded) - decoder.avail_out);
+
+			if(decode_result == Z_STREAM_END)
+			{
+				download.decoder_finished = true;
+
+				//Another member starts only with the gzip magic bytes. A single byte left is checked with the next chunk.
+				if(download.decoder_gzip && decoder.avail_in == 1)
+				{
+					download.decoder_lead.assign(reinterpret_cast<const char*>(decoder.next_in), 1);
+				}
+				else if(download.decoder_gzip && decoder.avail_in > 1)
+				{
+					if(decoder.next_in[0] == 0x1f && decoder.next_in[1] == 0x8b)
+					{
+						download.decoder_finished = (inflateReset(&decoder) != Z_OK);
+
+						success = !download.decoder_finished;
+					}
+					else
+					{
+						download.decoder_trailer = true;
+					}
+				}
+			}
+			else if(decode_result == Z_BUF_ERROR)
+			{
+				break;
+			}
+			else if(decode_result != Z_OK)
+			{
+				success = false;
+			}
+		}
+	}
+	else if(download.content_coding == coding_brotli)
 	{
-		for(const auto& row : *query_values)
+		if(!download.decoder_ready)
+		{
+			download.brotli_decoder = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+			download.decoder_ready = (download.brotli_decoder != nullptr);
+
+			success = download.decoder_ready;
+		}
+
+		const uint8_t* next_in = reinterpret_cast<const uint8_t*>(data);
+		std::size_t available_in = data_size;
+
+		BrotliDecoderResult decode_result = BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+
+		while(success && !download.decoder_finished && (available_in > 0 || decode_result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT))
 		{
-			for(const auto& column : row)
+			uint8_t* next_out = decoded;
+			std::size_t available_out = sizeof(decoded);
+
+			decode_result = 
+			BrotliDecoderDecompressStream(download.brotli_decoder, &available_in, &next_in, &available_out, &next_out, nullptr);
+
+			download.received.append(reinterpret_cast<const char*>(decoded), sizeof(decoded) - available_out);
+
+			if(decode_result == BROTLI_DECODER_RESULT_SUCCESS)
 			{
-				std::cout << "column name:" << column.first << "| column value:" << column.second << "\n";
+				download.decoder_finished = true;
+			}
+			else if(decode_result == BROTLI_DECODER_RESULT_ERROR)
+			{
+				success = false;
 			}
 		}
 	}
 
-	return;
+	download.bytes_decoded += static_cast<long long>(download.received.size() - received_size);
+	download.decode_time += std::chrono::steady_clock::now() - decode_start;
+
+	return success;
 }
 
 static void 
-enable_op_sql_trace(sqlite3** db_connection)
+feed_download_end_decode(feed_download& download)
 {
-	if(_sql_trace_enabled && !_sql_trace_active)
+	if(download.zlib_decoder.state)
 	{
-		sqlite3_trace(*db_connection, trace_sql_op, nullptr);
+		inflateEnd(&download.zlib_decoder);
+	}
 
-		_sql_trace_active = true;
+	if(download.brotli_decoder)
+	{
+		BrotliDecoderDestroyInstance(download.brotli_decoder);
+
+		download.brotli_decoder = nullptr;
 	}
 
+	download.decoder_ready = false;
+
 	return;
 }
 
 static void 
-trace_sql_op(void* in1, const char* in2)
+save_feed_transfer(const std::string& feed_name, const feed_download& download, const long response_code)
 {
-	if(_sql_trace_active)
-	{
-		if(in1)
-		{
-			std::cout << " ";
-		}
+	gautier::rss_model::unit_type_feed_transfer feed_transfer;
 
-		std::cout << in2 << "\n";
-	}
+	curl_off_t transfer_microseconds = 0;
+
+	curl_easy_getinfo(download.transfer, CURLINFO_TOTAL_TIME_T, &transfer_microseconds);
+
+	feed_transfer.response_code = response_code;
+	feed_transfer.content_encoding = download.content_encoding;
+	feed_transfer.bytes_received = download.bytes_received;
+	feed_transfer.bytes_decoded = (download.content_coding == coding_identity) ? download.bytes_received : download.bytes_decoded;
+	feed_transfer.decode_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(download.decode_time).count();
+	feed_transfer.transfer_microseconds = static_cast<long long>(transfer_microseconds);
+
+	std::lock_guard<std::mutex> feed_transfers_guard(_feed_transfers_lock);
+
+	_feed_transfers[feed_name] = feed_transfer;
 
 	return;
 }
 
+//Adds to the totals for the stage and, when feed_name is given, to those of the feed.
 static void 
-enable_op_sql_autolog()
+record_stage_time(const std::string& stage_name, const std::string& feed_name, const std::chrono::steady_clock::duration elapsed)
 {
-	if(_sql_trace_enabled)
+	if(_metrics_enabled)
 	{
-		sqlite3_config(SQLITE_CONFIG_LOG, log_sql_op_event, nullptr);
+		const long long microseconds = 
+		std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+		std::lock_guard<std::mutex> metrics_guard(_metrics_lock);
+
+		add_stage_time(_metrics.stages[stage_name], microseconds);
+
+		if(!feed_name.empty())
+		{
+			add_stage_time(_metrics.feeds[feed_name].stages[stage_name], microseconds);
+		}
 	}
 
 	return;
 }
 
-void 
-log_sql_op_event(void *pArg, int iErrCode, const char *zMsg)
+//Adds each counter of feed_counts to those of the feed.
+static void 
+record_feed_counts(const std::string& feed_name, const gautier::rss_model::unit_type_feed_metrics& feed_counts)
 {
-	if(_sql_trace_enabled && _sql_trace_active)
+	if(_metrics_enabled)
 	{
-		if(pArg)
-		{
-			std::cout << __FILE__ << "(" << __LINE__ << ") ";
-		}
+		std::lock_guard<std::mutex> metrics_guard(_metrics_lock);
 
-		std::cout 
-		<< iErrCode << " " 
-		<< zMsg;
+		gautier::rss_model::unit_type_feed_metrics& feed_metrics = 
+		_metrics.feeds[feed_name];
+
+		feed_metrics.items_parsed += feed_counts.items_parsed;
+		feed_metrics.rows_staged += feed_counts.rows_staged;
+		feed_metrics.rows_inserted += feed_counts.rows_inserted;
+		feed_metrics.rows_deduplicated += feed_counts.rows_deduplicated;
+		feed_metrics.bytes_fetched += feed_counts.bytes_fetched;
 	}
 
 	return;
 }
 
 static void 
-output_op_sql_error_message(sqlite3** db_connection, const int& line_number)
+add_stage_time(gautier::rss_model::unit_type_stage_metrics& stage_metrics, const long long microseconds)
 {
-	std::cout 
-	<< sqlite3_errmsg(*db_connection) << " " 
-	<< line_number 
-	<< "\n";
+	stage_metrics.count++;
+	stage_metrics.total_microseconds += microseconds;
+	stage_metrics.max_microseconds = std::max(stage_metrics.max_microseconds, microseconds);
+
+	decltype(stage_metrics.latency_histogram)::size_type bucket_n = 0;
+
+	for(long long bucket_limit = 10; microseconds >= bucket_limit && bucket_n + 1 < stage_metrics.latency_histogram.size(); bucket_limit *= 10)
+	{
+		bucket_n++;
+	}
+
+	stage_metrics.latency_histogram[bucket_n]++;
 
 	return;
 }
 
 static void 
-output_op_sql_error_message(char** error_message, const int& line_number)
+output_stage_metrics(std::ostream& metrics_output, const gautier::rss_model::unit_type_stage_metrics& stage_metrics)
 {
-	std::cout 
-	<< *error_message << " " 
-	<< line_number 
-	<< "\n";
+	metrics_output 
+	<< "\t" << stage_metrics.count 
+	<< "\t" << stage_metrics.total_microseconds 
+	<< "\t" << stage_metrics.max_microseconds;
 
-	sqlite3_free(*error_message);
+	for(const auto bucket_count : stage_metrics.latency_histogram)
+	{
+		metrics_output << "\t" << bucket_count;
+	}
 
-	*error_message = nullptr;
+	metrics_output << "\n";
 
 	return;
 }
 
-//Support functions.
-static int 
-switch_letter_case (const char& in_char)
-{
-	return std::tolower(in_char);
-}
-
 //Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0 . Software distributed under the License is distributed on an "AS IS" BASIS, NO WARRANTIES OR CONDITIONS OF ANY KIND, explicit or implicit. See the License for details on permissions and limitations.
 
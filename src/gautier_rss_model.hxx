@@ -1,6 +1,10 @@
 #ifndef __gautier_rss_model__
 #define __gautier_rss_model__
 
+#include <array>
+#include <atomic>
+#include <functional>
+#include <limits>
 #include <string>
 #include <map>
 #include <vector>
@@ -13,12 +17,30 @@ namespace gautier
 		{
 			int 
 				id{0},
-				type_code{0}
+				type_code{0},
+				//From the ttl element of the channel. Minutes the feed may be kept before downloading it again.
+				ttl_minutes{0},
+				//From the skipHours and skipDays elements of the channel.
+				//Bit n is set for hour n, GMT, or for day n counting from Sunday, when the feed is not downloaded.
+				skip_hours{0},
+				skip_days{0},
+				//Days feed items are kept after they are saved, see purge_feeds. 0 uses the default passed to it.
+				retention_days{0}
+			;
+
+			long long 
+				//Seconds since the epoch when the feed is next downloaded.
+				//Learned from how often the feed publishes. 0 until the feed is first downloaded.
+				next_due{0}
 			;
 
 			std::string 
 				name{""},
-				url{""}
+				url{""},
+				//HTTP cache validators from the last download of the feed.
+				//Sent back with the next request so an unchanged feed is not downloaded again.
+				etag{""},
+				last_modified{""}
 			;
 		};
 
@@ -28,6 +50,12 @@ namespace gautier
 				id{0}
 			;
 
+			long long 
+				//Seconds since the epoch of pubdate, set when the item is read from the database.
+				//0 when pubdate is not an RFC 822 or RFC 3339 date.
+				pub_date_epoch{0}
+			;
+
 			std::string 
 				title{},
 				link{},
@@ -36,6 +64,139 @@ namespace gautier
 			;
 		};
 
+		//A feed item found by search_feed_items.
+		struct unit_type_rss_search_match
+		{
+			std::string 
+				feed_name{""}
+			;
+
+			unit_type_rss_item 
+				feed_item
+			;
+		};
+
+		//Where the next page of a feed starts, for the paged load_feed.
+		//The default value starts at the first item. Moved past the last item of each page returned.
+		struct unit_type_feed_page_cursor
+		{
+			long long 
+				//Feed item id, a rowid.
+				id{0},
+				//Items dated before 1970 are counted from the lowest value, so the default does not skip them.
+				pub_date_epoch{std::numeric_limits<long long>::min()}
+			;
+		};
+
+		//Network transfer of the last download of a feed.
+		struct unit_type_feed_transfer
+		{
+			long 
+				//HTTP status of the response. 304 when the feed was unchanged.
+				response_code{0}
+			;
+
+			std::string 
+				//Empty when the feed was sent uncompressed.
+				content_encoding{""}
+			;
+
+			long long 
+				//Bytes of the response body as received, before decompression.
+				bytes_received{0},
+				//Bytes given to the parser, after decompression.
+				bytes_decoded{0},
+				decode_microseconds{0},
+				//Whole transfer, from the start of the request until the last byte.
+				transfer_microseconds{0}
+			;
+		};
+
+		//Time taken by one stage of collecting or loading feeds.
+		struct unit_type_stage_metrics
+		{
+			long long 
+				count{0},
+				total_microseconds{0},
+				max_microseconds{0}
+			;
+
+			//Bucket n counts calls that took less than 10^(n+1) microseconds and at least 10^n.
+			//The first bucket also counts shorter calls. The last counts calls of 10 seconds or more.
+			std::array<long long, 8> 
+				latency_histogram{}
+			;
+		};
+
+		struct unit_type_feed_metrics
+		{
+			long long 
+				items_parsed{0},
+				rows_staged{0},
+				//Staged rows new to the saved feed items.
+				rows_inserted{0},
+				//Staged rows whose link was already saved.
+				rows_deduplicated{0},
+				//Bytes received over the network, before decompression.
+				bytes_fetched{0}
+			;
+
+			std::map<std::string, unit_type_stage_metrics> 
+				stages
+			;
+		};
+
+		//Stages are fetch, parse, staging_insert, merge, purge, load_feeds and load_feeds_since.
+		//fetch covers waiting on the network and decompression. parse is the rest of reading a feed.
+		//merge runs once for all feeds saved together, so it is only given in total.
+		struct unit_type_rss_metrics
+		{
+			std::map<std::string, unit_type_stage_metrics> 
+				stages
+			;
+
+			//By feed name.
+			std::map<std::string, unit_type_feed_metrics> 
+				feeds
+			;
+		};
+
+		//How the feeds database is opened.
+		//The default values match those of an unconfigured SQLite database.
+		struct unit_type_storage_settings
+		{
+			bool 
+				//Write-ahead log journaling. Readers do not wait on a writer and commits are cheaper.
+				//Once set, the database file stays in this mode.
+				write_ahead_log{false}
+			;
+
+			int 
+				//Pages when positive, KiB when negative.
+				cache_size{-2000}
+			;
+
+			long long 
+				//Bytes of the database file to memory map. 0 turns memory mapping off.
+				mmap_size{0}
+			;
+
+			std::string 
+				//Created if it does not exist. Relative to the working directory unless a full path is given.
+				database_file_name{"rss_feeds_info.db"},
+				//OFF, NORMAL, FULL or EXTRA. NORMAL is safe, and faster, with write_ahead_log.
+				synchronous{"FULL"},
+				//DEFAULT, FILE or MEMORY.
+				temp_store{"DEFAULT"}
+			;
+		};
+
+		//Applies to database connections opened after the call.
+		//A different database file is only used once connections to the current one are closed.
+		//Call before any other function in this module, or after close_feeds_storage.
+		void 
+		set_storage_settings(const unit_type_storage_settings& storage_settings);
+
 		//Should always call this at least once before any other function in this module.
 		void 
 		load_feeds_source_list(const std::string& feeds_list_file_name, std::map<std::string, unit_type_rss_source>& feed_sources);
@@ -44,6 +205,12 @@ namespace gautier
 		void 
 		load_feeds_source_list(std::map<std::string, unit_type_rss_source>& feed_sources);
 
+		//Limits how many feed sources are downloaded and parsed at the same time.
+		//The per host limit keeps a single network from receiving too many requests at once.
+		//Values below 1 are treated as 1. Call before collect_feeds.
+		void 
+		set_collect_concurrency(const int max_connections, const int max_connections_per_host);
+
 		//Collects and saves feeds.
 		//Gathered feed items can be retrieved more selectively by the application.
 		//*Recommended way to gather feed items.
@@ -57,11 +224,52 @@ namespace gautier
 		void 
 		collect_feeds(const std::map<std::string, unit_type_rss_source>& feed_sources, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
 
+		//Collects and saves feeds, one feed source at a time.
+		//feed_saved is called with the name of each feed source once its items are saved,
+		//	while other feeds may still be downloading. It runs on the calling thread.
+		//Useful for showing feeds as they arrive when collect_feeds runs off the user interface thread.
+		void 
+		collect_feeds(const std::map<std::string, unit_type_rss_source>& feed_sources, const std::function<void(const std::string& feed_name)>& feed_saved);
+
+		//As above, and returns soon once stop_requested is set from another thread, such as when the program is closing.
+		//Feeds not yet started are skipped and downloads under way are abandoned, within a second.
+		//Feeds already saved are kept. Skipped feeds keep their schedule. Only this call is stopped.
+		void 
+		collect_feeds(const std::map<std::string, unit_type_rss_source>& feed_sources, const std::function<void(const std::string& feed_name)>& feed_saved, const std::atomic<bool>& stop_requested);
+
+		//Removes feed items saved more than default_retention_days ago, or the retention_days of their feed source when set.
+		//Items of a feed are kept when both are 0. Leftover staging rows from saving feeds are removed as well.
+		//Rows are removed batch_size at a time, each batch in its own short transaction,
+		//	so saving feeds is never held up for long. Independent of collect_feeds, and meant to be run on its own schedule.
+		//The most recently saved item is kept even when expired, so ids are not reused, see load_feeds_since.
+		//Returns the number of feed items removed.
+		long long 
+		purge_feeds(const int default_retention_days, const int batch_size);
+
 		//Returns all rss feed items previously collected.
 		//Useful for caching all feeds items previously collected.
 		void 
 		load_feeds(std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
 
+		//Returns up to page_size rss feed items of an rss feed source, in the same order as load_feed, following the cursor.
+		//The cursor is moved to the last item returned. No items are returned past the end of the feed.
+		//Each page is read from an index, so the time taken does not depend on how far into the feed the page is.
+		void 
+		load_feed(const unit_type_rss_source& feed_source, const int page_size, unit_type_feed_page_cursor& cursor, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
+
+		//Matches feeds by name of the feed source.
+		void 
+		load_feed(const std::string feed_source_name, const int page_size, unit_type_feed_page_cursor& cursor, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
+
+		//Returns the rss feed items saved after the watermark, in the same order as load_feeds.
+		//Pass a watermark of 0 to get all items. It is then set to the value to pass to the next call,
+		//	so each item is returned once and the cost of a call grows only with the items added since the last one.
+		//The watermark is the highest feed item id returned. Unchanged when no items were added.
+		//Items saved later always have higher ids. Ids are only handed out above the highest saved id,
+		//	and purge_feeds never removes the row holding it.
+		void 
+		load_feeds_since(long long& watermark, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
+
 		//Returns all rss feed items previously collected for an rss feed source.
 		//*Recommended way to access feed items after collecting them.
 		void 
@@ -73,9 +281,65 @@ namespace gautier
 		void 
 		load_feed(const std::string feed_source_name, std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items);
 
+		//Receives one feed item at a time from visit_feeds and visit_feed.
+		//The feed name and item are only valid during the call. Copy what is kept.
+		using type_feed_item_visitor = std::function<void(const std::string& feed_name, const unit_type_rss_item& feed_item)>;
+
+		//Passes every rss feed item previously collected to the visitor, in the same order as load_feeds.
+		//Items are read from the database one at a time, so memory use does not grow with the number of items.
+		//The database is read until the call returns. Saving feeds from the visitor waits on that read
+		//	unless write_ahead_log is set.
+		void 
+		visit_feeds(const type_feed_item_visitor& feed_item_visitor);
+
+		//Passes the rss feed items previously collected for an rss feed source to the visitor, in the same order as load_feed.
+		//Matches the feed source by id, or by name when the id is 0.
+		void 
+		visit_feed(const unit_type_rss_source& feed_source, const type_feed_item_visitor& feed_item_visitor);
+
+		//Returns up to limit rss feed items, from every feed, whose title or description contain all the words of search_text.
+		//Best matches come first. The last word, when longer than two letters, also matches words that start with it.
+		//Case and accents are ignored. Returns nothing when search_text has no words, or when SQLite was built without FTS5.
+		void 
+		search_feed_items(const std::string& search_text, const int limit, std::vector<unit_type_rss_search_match>& search_matches);
+
+		//Reads the items of one feed document from a file or web address without saving them.
+		//The streaming reader is used unless use_document_tree is true. It reads RSS 2.0, RSS 1.0 and Atom 1.0.
+		//The document tree reader holds the whole document in memory and is kept for comparison. It reads RSS only.
+		//Returns false if the document could not be read.
+		bool 
+		parse_feed(const std::string& feed_location, std::vector<unit_type_rss_item>& feed_items, const bool use_document_tree);
+
+		//Returns the network transfer of the last download of each feed, by feed name.
+		//Covers feeds downloaded since the program started. Feeds read from files are not included.
+		void 
+		load_feed_transfers(std::map<std::string, unit_type_feed_transfer>& feed_transfers);
+
+		//Metrics are off by default and gathered only while enabled.
+		//Can be switched at any time, from any thread.
+		void 
+		set_metrics_enabled(const bool enabled);
+
+		//Returns the metrics gathered since the program started or since reset_metrics.
+		void 
+		load_metrics(unit_type_rss_metrics& metrics);
+
+		void 
+		reset_metrics();
+
+		//Writes the metrics gathered so far to a text file as tab separated lines.
+		//Returns false if the file could not be written.
+		bool 
+		output_metrics(const std::string& file_name);
+
 		void 
 		create_feed_items_list(const std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>& rss_feed_items, std::vector<unit_type_rss_item>& rss_items);
 
+		//Closes the database connections the module keeps open between calls.
+		//Optional. They are also closed when the program ends, and reopened by the next call that needs them.
+		void 
+		close_feeds_storage();
+
 		//output to std out.
 		//terminal output.
 		//possible, future output to html file.
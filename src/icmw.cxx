@@ -1,6 +1,8 @@
 #include "icmw.hxx"
 #include "gautier_rss_model.hxx"
+#include <atomic>
 #include <cmath>
+#include <thread>
 
 using namespace gautier::rss::rt;
 
@@ -13,9 +15,7 @@ Fl_Hold_Browser* _render_target_feed_items = nullptr;
 Fl_Help_View* _render_target_feed_item_details = nullptr;
  
 Fl_Button* _ictrigger_refresh = nullptr;
-	
-int _LastWidth = 0;
-int _LastHeight = 0;
+Fl_Input* _ictrigger_search = nullptr;
 
 int _feed_sources_width = 300;
 
@@ -23,32 +23,185 @@ const double _AvgPhysicalScreenSize = 13.667;
 const double _FontSize = 12;
 const double _PrintPointSize = 72.0;
 
+//How often feed sources are checked for expired feeds while the window is open.
+const double _feed_refresh_seconds = 300.0;
+
+//Most search matches shown at once.
+const int _search_match_limit = 200;
+
+//Days feed items are kept when the feeds list does not say. Purged once a session, after the first collection.
+const int _feed_retention_days = 31;
+const int _feed_purge_batch_size = 500;
+
 std::map<std::string, gautier::rss_model::unit_type_rss_source> _rss_feed_sources;
 std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>> _rss_feed_items;
 
 std::string _current_feed_name;
 
-void feed_items_callback(Fl_Widget* s, void* data) {
-	int rtfs_i = _render_target_feed_items->value();
-	const char* feed_item_name = _render_target_feed_items->text(rtfs_i);
+//Shown in the feed items browser in place of the current feed until a feed source is selected.
+std::vector<gautier::rss_model::unit_type_rss_search_match> _search_matches;
+bool _showing_search_matches = false;
+
+//Downloads feeds while the window is up. See collect_feeds_in_background.
+std::thread _feed_collector;
+std::atomic<bool> _feed_collector_running{false};
+//Set once the window is gone, so _feed_collector stops instead of finishing its collection.
+std::atomic<bool> _feed_collector_stopping{false};
 
-	if(feed_item_name)
+//Row n of the feed items browser shows item n - 1 of the current feed. feed_items_callback relies on it.
+void show_feed_items() {
+	const std::vector<gautier::rss_model::unit_type_rss_item>& feed_items = _rss_feed_items[_current_feed_name];
+	
+	std::cout << "feed item count: " << feed_items.size() << "\r\n";
+	
+	_render_target_feed_items->clear();
+	
+	for(auto& feed_item : feed_items)
 	{
-		std::vector<gautier::rss_model::unit_type_rss_item> feed_items = _rss_feed_items[_current_feed_name];
+		const char* rss_headline = feed_item.title.data();
 
-		_render_target_feed_item_details->value("");
-		
-		for(auto& feed_item : feed_items)
+		_render_target_feed_items->add(rss_headline);
+	}
+
+	return;
+}
+
+//Row n of the feed items browser shows search match n - 1. feed_items_callback relies on it.
+void show_search_matches() {
+	std::cout << "search match count: " << _search_matches.size() << "\r\n";
+
+	_render_target_feed_items->clear();
+
+	for(auto& search_match : _search_matches)
+	{
+		const std::string rss_headline = search_match.feed_item.title + " (" + search_match.feed_name + ")";
+
+		_render_target_feed_items->add(rss_headline.data());
+	}
+
+	return;
+}
+
+//Runs on the user interface thread through Fl::awake.
+//Takes ownership of feed items loaded by collect_feeds_in_background.
+void feed_items_loaded_callback(void* data) {
+	std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>* loaded_feed_items = 
+	static_cast<std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>*>(data);
+
+	for(auto& loaded_feed : *loaded_feed_items)
+	{
+		_rss_feed_items[loaded_feed.first] = std::move(loaded_feed.second);
+
+		if(loaded_feed.first == _current_feed_name && !_showing_search_matches)
 		{
-			if(feed_item.title == feed_item_name)
-			{
-				const char* rss_details = feed_item.description.data();
+			show_feed_items();
+		}
+	}
+
+	delete loaded_feed_items;
+
+	return;
+}
+
+//Hands loaded feed items to the user interface thread.
+void post_feed_items_loaded(std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>* loaded_feed_items) {
+	//The awake queue is full. The items are shown after the next collection.
+	if(Fl::awake(feed_items_loaded_callback, loaded_feed_items) != 0)
+	{
+		delete loaded_feed_items;
+	}
+
+	return;
+}
+
+//Runs on _feed_collector, away from the user interface thread.
+//Widgets are only touched by feed_items_loaded_callback on the user interface thread.
+//The first run shows items saved by earlier runs, later runs refresh which feeds have expired.
+//Each feed is then shown again as soon as it is downloaded.
+void collect_feeds_in_background(std::map<std::string, gautier::rss_model::unit_type_rss_source> feed_sources, const bool first_run) {
+	if(first_run)
+	{
+		std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>* loaded_feed_items = 
+		new std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>();
 
-				_render_target_feed_item_details->value(rss_details);
+		gautier::rss_model::load_feeds(*loaded_feed_items);
 
-				break;
-			}
+		post_feed_items_loaded(loaded_feed_items);
+	}
+	else
+	{
+		gautier::rss_model::load_feeds_source_list(feed_sources);
+	}
+
+	gautier::rss_model::collect_feeds(feed_sources, [](const std::string& feed_name)
+	{
+		if(_feed_collector_stopping)
+		{
+			return;
 		}
+
+		std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>* loaded_feed_items = 
+		new std::map<std::string, std::vector<gautier::rss_model::unit_type_rss_item>>();
+
+		gautier::rss_model::load_feed(feed_name, *loaded_feed_items);
+
+		post_feed_items_loaded(loaded_feed_items);
+	}, _feed_collector_stopping);
+
+	//After collecting, so showing new items is not delayed.
+	if(first_run && !_feed_collector_stopping)
+	{
+		gautier::rss_model::purge_feeds(_feed_retention_days, _feed_purge_batch_size);
+	}
+
+	_feed_collector_running = false;
+
+	return;
+}
+
+//Does nothing while a collection is still in progress.
+void start_feed_collection(const bool first_run) {
+	if(_rss_feed_sources.empty() || _feed_collector_running)
+	{
+		return;
+	}
+
+	if(_feed_collector.joinable())
+	{
+		_feed_collector.join();
+	}
+
+	_feed_collector_running = true;
+	_feed_collector = std::thread(collect_feeds_in_background, _rss_feed_sources, first_run);
+
+	return;
+}
+
+void feed_refresh_timeout_callback(void* data) {
+	start_feed_collection(false);
+
+	Fl::repeat_timeout(_feed_refresh_seconds, feed_refresh_timeout_callback);
+
+	return;
+}
+
+void feed_items_callback(Fl_Widget* s, void* data) {
+	int rtfs_i = _render_target_feed_items->value();
+
+	const std::vector<gautier::rss_model::unit_type_rss_item>& feed_items = _rss_feed_items[_current_feed_name];
+
+	//Browser rows are numbered from 1 and 0 means no selection.
+	if(_showing_search_matches && rtfs_i > 0 && static_cast<std::size_t>(rtfs_i) <= _search_matches.size())
+	{
+		const char* rss_details = _search_matches[rtfs_i - 1].feed_item.description.data();
+
+		_render_target_feed_item_details->value(rss_details);
+	}
+	else if(!_showing_search_matches && rtfs_i > 0 && static_cast<std::size_t>(rtfs_i) <= feed_items.size())
+	{
+		const char* rss_details = feed_items[rtfs_i - 1].description.data();
+
+		_render_target_feed_item_details->value(rss_details);
 	}
 	else
 	{
@@ -69,19 +222,10 @@ void feed_sources_callback(Fl_Widget* s, void* data) {
 		std::string feed_source_url = std::string(_rss_feed_sources[_current_feed_name].url);
 
 		std::cout << feed_source_name << " @ " << feed_source_url << "\r\n";
-		
-		std::vector<gautier::rss_model::unit_type_rss_item> feed_items = _rss_feed_items[_current_feed_name];
-		
-		std::cout << "feed item count: " << feed_items.size() << "\r\n";
-		
-		_render_target_feed_items->clear();
-		
-		for(auto& feed_item : feed_items)
-		{
-			const char* rss_headline = feed_item.title.data();
 
-			_render_target_feed_items->add(rss_headline);
-		}
+		_showing_search_matches = false;
+		
+		show_feed_items();
 	}
 	else
 	{
@@ -94,6 +238,35 @@ void feed_sources_callback(Fl_Widget* s, void* data) {
 void ictrigger_refresh_callback(Fl_Widget* s) {
 	std::cout << "refesh button clicked\r\n";
 
+	start_feed_collection(false);
+
+	return;
+}
+
+//Searches every feed when enter is pressed in the search box.
+//An empty search goes back to the current feed.
+void ictrigger_search_callback(Fl_Widget* s) {
+	const std::string search_text = _ictrigger_search->value();
+
+	_render_target_feed_item_details->value("");
+
+	if(search_text.find_first_not_of(" \t") == std::string::npos)
+	{
+		_showing_search_matches = false;
+
+		_search_matches.clear();
+
+		show_feed_items();
+	}
+	else
+	{
+		gautier::rss_model::search_feed_items(search_text, _search_match_limit, _search_matches);
+
+		_showing_search_matches = true;
+
+		show_search_matches();
+	}
+
 	return;
 }
 
@@ -119,6 +292,20 @@ void resize_workarea(int w, int h) {
 	return;
 }
 
+void icmw::resize(int x, int y, int w, int h) {
+	Fl_Double_Window::resize(x, y, w, h);
+
+	//render sizes the window before the feed widgets exist.
+	if(_render_target_root)
+	{
+		resize_workarea(w, h);
+
+		redraw();
+	}
+
+	return;
+}
+
 int icmw::render() {
 	int dv = 2, ht = 8, xy = 0;
 
@@ -178,6 +365,17 @@ int icmw::render() {
 
         LabelW = 0;//Revision 9/4/2017 6:20PM
         LabelH = 0;//Revision 9/4/2017 6:20PM
+
+        fl_measure("WWWWWWWWWWWWWW", LabelW, LabelH);
+
+        _ictrigger_search = new Fl_Input(xy, xy, LabelW * 2, LabelH);
+        _ictrigger_search->textsize(ScaledFontSizeD);
+        _ictrigger_search->tooltip("Search all feeds. Press enter to search.");
+	_ictrigger_search->when(FL_WHEN_ENTER_KEY_ALWAYS);
+	_ictrigger_search->callback(ictrigger_search_callback);
+
+        LabelW = 0;
+        LabelH = 0;
         
 	Fl_Group::current(_render_target_feed_items_root);
 
@@ -186,7 +384,17 @@ int icmw::render() {
 
 	resize_workarea(workarea_w, workarea_h);
 
-	//This part needs to be in a separate thread or timer or something
+	//Enables Fl::awake from _feed_collector.
+	Fl::lock();
+
+	//The user interface thread reads the database while _feed_collector writes to it.
+	gautier::rss_model::unit_type_storage_settings storage_settings;
+
+	storage_settings.write_ahead_log = true;
+	storage_settings.synchronous = "NORMAL";
+
+	gautier::rss_model::set_storage_settings(storage_settings);
+
 	std::string rss_feeds_sources_file_name = "feeds.txt";
 
 	gautier::rss_model::load_feeds_source_list(rss_feeds_sources_file_name, _rss_feed_sources);
@@ -198,33 +406,29 @@ int icmw::render() {
 		_render_target_feed_sources->add(feed_source_name);
 	}
 
-	if(!_rss_feed_sources.empty())
-	{
-		gautier::rss_model::collect_feeds(_rss_feed_sources);
-		
-		gautier::rss_model::load_feeds(_rss_feed_items);
-	}
-	//end multi-threaded part
-
-
 	end();
 	show();
 
-	while(Fl::check()) {
-		int _ThisW = this->w();
-		int _ThisH = this->h();
+	start_feed_collection(true);
 
-		if(_ThisW != _LastWidth || _ThisH != _LastHeight) {
-			resize_workarea(_ThisW, _ThisH);
+	Fl::add_timeout(_feed_refresh_seconds, feed_refresh_timeout_callback);
 
-			_LastWidth = _ThisW;
-			_LastHeight = _ThisH;
-			
-			redraw();
-		}		
+	//Sleeps until there is input, a timer or an Fl::awake from _feed_collector.
+	Fl::run();
+
+	Fl::remove_timeout(feed_refresh_timeout_callback);
+
+	//Feed items still arriving are not shown once the window is gone.
+	//The collector skips the feeds it has not started and abandons its downloads, so the join does not wait for them.
+	_feed_collector_stopping = true;
+
+	if(_feed_collector.joinable())
+	{
+		_feed_collector.join();
 	}
 
 	delete _render_target_feed_item_details;
+	delete _ictrigger_search;
 	delete _ictrigger_refresh;
 	delete _render_target_feed_items_ictriggers;
 	delete _render_target_feed_items;
@@ -23,6 +23,7 @@ namespace gautier {
 				public:
 					
 					int render();
+					void resize(int x, int y, int w, int h) override;
 					icmw() : Fl_Double_Window(0,0,0,0) {
 						return;
 					};